@@ -0,0 +1,70 @@
+#!/bin/sh
+# Linux benchmark suite: builds every lab with g++ and runs its scene
+# headless (EGL) for a fixed number of frames at several scales, with the
+# fixed-step clock so every run renders the same frames. All runs end up in
+# one JSON file with CPU time, GPU time and peak memory per scene.
+#
+#   ./benchmark.sh [frames] [results.json]
+#
+# Needs g++, GLFW, EGL and glm. Labs without their own include/ directory
+# use the headers from l5/include. CXX, CXXFLAGS and LIBS can be overridden.
+set -e
+cd "$(dirname "$0")"
+
+FRAMES=${1:-300}
+RESULTS=${2:-benchmark_results.json}
+BUILD=_bench
+CXX=${CXX:-g++}
+CXXFLAGS=${CXXFLAGS:--O2 -std=c++17}
+LIBS=${LIBS:--lglfw -lEGL -ldl -pthread}
+
+mkdir -p "$BUILD"
+LINES="$PWD/$BUILD/results.jsonl"
+: > "$LINES"
+
+# build <lab> <source> <binary>
+build() {
+  echo "build $3"
+  $CXX $CXXFLAGS -I"$1/include" -Il5/include "$1/src/$2.cpp" "$1/src/glad.c" \
+    $LIBS -o "$BUILD/$3"
+}
+
+# run <lab> <binary> <scale>... (from src/, like the VS Code launch config)
+run() {
+  lab=$1
+  binary=$2
+  shift 2
+  for scale in "$@"; do
+    echo "run $binary --scale $scale"
+    (cd "$lab/src" && "../../$BUILD/$binary" --headless --frames "$FRAMES" \
+      --clock fixed --scale "$scale" --bench "$LINES") \
+      > "$BUILD/$binary-$scale.log"
+  done
+}
+
+build l1 main l1
+build l2 main l2
+build l2 main2 l2-main2
+build l3 main l3
+build l4 main l4
+build l5 main l5
+build l6 main l6
+build l7 main l7
+build l8 main l8
+
+run l1 l1 1
+run l2 l2 1
+run l2 l2-main2 1
+run l3 l3 1000 100000 1000000
+run l4 l4 1
+run l5 l5 1
+run l6 l6 1 16 256
+run l7 l7 1 64 1024
+run l8 l8 1 64 1024
+
+{
+  echo "{\"frames\": $FRAMES, \"results\": ["
+  sed '$!s/$/,/' "$LINES"
+  echo "]}"
+} > "$RESULTS"
+echo "results: $RESULTS"
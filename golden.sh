@@ -0,0 +1,87 @@
+#!/bin/sh
+# Golden-image regression: renders every lab headless with the fixed-step
+# clock, so frame N is the same image on every run, and compares the last
+# frame with the reference in golden/<scene>.ppm. Each scene must also stay
+# within the median frame time stored in golden/budgets.txt.
+#
+#   ./golden.sh            check all scenes, exit 1 if any fails
+#   ./golden.sh --update   re-render the references and re-measure budgets
+#
+# Budgets are written as 3x the measured median (at least 5 ms) so they
+# catch real slowdowns, not noise; --update only on a machine you trust.
+# Uses the same build as benchmark.sh (CXX, CXXFLAGS and LIBS).
+set -e
+cd "$(dirname "$0")"
+
+FRAMES=60
+GOLDEN=golden
+BUILD=_golden
+CXX=${CXX:-g++}
+CXXFLAGS=${CXXFLAGS:--O2 -std=c++17}
+LIBS=${LIBS:--lglfw -lEGL -ldl -pthread}
+TOLERANCE=${TOLERANCE:-0.1}
+UPDATE=0
+[ "$1" = "--update" ] && UPDATE=1
+
+mkdir -p "$BUILD" "$GOLDEN"
+[ -f "$GOLDEN/budgets.txt" ] || : > "$GOLDEN/budgets.txt"
+[ $UPDATE -eq 1 ] && : > "$BUILD/budgets.txt"
+
+# build <lab> <source> <binary>
+build() {
+  $CXX $CXXFLAGS -I"$1/include" -Il5/include "$1/src/$2.cpp" "$1/src/glad.c" \
+    $LIBS -o "$BUILD/$3"
+}
+
+FAILED=0
+
+# check <lab> <binary> <scale>
+check() {
+  lab=$1
+  scene=$2
+  args="--headless --frames $FRAMES --clock fixed --scale $3"
+  reference="$PWD/$GOLDEN/$scene.ppm"
+
+  if [ $UPDATE -eq 1 ]; then
+    (cd "$lab/src" && "../../$BUILD/$scene" $args --capture "$reference" \
+      --stats-json "../../$BUILD/$scene.json") > "$BUILD/$scene.log"
+    median=$(sed -n 's/.*"p50_ms": \([0-9.]*\).*/\1/p' "$BUILD/$scene.json")
+    budget=$(awk -v m="$median" 'BEGIN { b = m * 3; printf "%.3f", b < 5 ? 5 : b }')
+    echo "$scene $budget" >> "$BUILD/budgets.txt"
+    echo "updated $scene (median ${median} ms, budget ${budget} ms)"
+    return
+  fi
+
+  budget=$(awk -v s="$scene" '$1 == s { print $2 }' "$GOLDEN/budgets.txt")
+  if (cd "$lab/src" && "../../$BUILD/$scene" $args --golden "$reference" \
+      --tolerance "$TOLERANCE" --frame-budget "${budget:-0}") \
+      > "$BUILD/$scene.log"; then
+    echo "ok     $scene"
+  else
+    echo "FAILED $scene (see $BUILD/$scene.log)"
+    FAILED=1
+  fi
+}
+
+build l1 main l1
+build l2 main l2
+build l2 main2 l2-main2
+build l3 main l3
+build l4 main l4
+build l5 main l5
+build l6 main l6
+build l7 main l7
+build l8 main l8
+
+check l1 l1 1
+check l2 l2 1
+check l2 l2-main2 1
+check l3 l3 1000
+check l4 l4 1
+check l5 l5 1
+check l6 l6 16
+check l7 l7 64
+check l8 l8 64
+
+[ $UPDATE -eq 1 ] && mv "$BUILD/budgets.txt" "$GOLDEN/budgets.txt"
+exit $FAILED
@@ -0,0 +1,220 @@
+#ifndef GL_COUNTERS_H
+#define GL_COUNTERS_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstdio>
+
+// Optional instrumentation on top of glad: installGlCounters() swaps the
+// glad_gl* function pointers for wrappers that count calls and forward to the
+// driver. Binds of the object that is already bound (glBindVertexArray(0)
+// after every draw, glUseProgram of the current program, ...) are counted
+// separately as redundant. Call endGlCounterFrame() once per frame.
+enum GlCounter {
+  GL_COUNT_DRAWS,
+  GL_COUNT_PROGRAM_BINDS,
+  GL_COUNT_VAO_BINDS,
+  GL_COUNT_TEXTURE_BINDS,
+  GL_COUNT_REDUNDANT_BINDS,
+  GL_COUNT_UNIFORM_UPLOADS,
+  GL_COUNT_BUFFER_UPLOADS,
+  GL_COUNTER_KINDS
+};
+
+struct GlCounterState {
+  bool installed = false;
+  long frame[GL_COUNTER_KINDS] = {};
+  long total[GL_COUNTER_KINDS] = {};
+  long max[GL_COUNTER_KINDS] = {};
+  long frames = 0;
+
+  GLuint program = 0;
+  GLuint vertexArray = 0;
+  GLenum activeTexture = 0;
+  GLuint textures[32] = {}; // GL_TEXTURE_2D per unit
+};
+
+inline GlCounterState &glCounters() {
+  static GlCounterState state;
+  return state;
+}
+
+// Generic forwarding wrapper. Id keeps functions with the same signature
+// (glUniform1fv / glUniform2fv, ...) apart.
+template <int Id, typename Result, typename... Args> struct GlCountedCall {
+  static Result(APIENTRYP original)(Args...);
+  static GlCounter counter;
+  static Result APIENTRY call(Args... args) {
+    glCounters().frame[counter]++;
+    return original(args...);
+  }
+};
+template <int Id, typename Result, typename... Args>
+Result(APIENTRYP GlCountedCall<Id, Result, Args...>::original)(Args...) = NULL;
+template <int Id, typename Result, typename... Args>
+GlCounter GlCountedCall<Id, Result, Args...>::counter = GL_COUNT_DRAWS;
+
+template <int Id, typename Result, typename... Args>
+void countGlCall(Result(APIENTRYP &pointer)(Args...), GlCounter counter) {
+  if (pointer == NULL)
+    return;
+  GlCountedCall<Id, Result, Args...>::original = pointer;
+  GlCountedCall<Id, Result, Args...>::counter = counter;
+  pointer = GlCountedCall<Id, Result, Args...>::call;
+}
+
+#define COUNT_GL_CALL(name, counter) countGlCall<__LINE__>(glad_##name, counter)
+
+// binds keep track of the current object to spot redundant calls
+inline PFNGLUSEPROGRAMPROC &originalUseProgram() {
+  static PFNGLUSEPROGRAMPROC pointer = NULL;
+  return pointer;
+}
+inline PFNGLBINDVERTEXARRAYPROC &originalBindVertexArray() {
+  static PFNGLBINDVERTEXARRAYPROC pointer = NULL;
+  return pointer;
+}
+inline PFNGLBINDTEXTUREPROC &originalBindTexture() {
+  static PFNGLBINDTEXTUREPROC pointer = NULL;
+  return pointer;
+}
+inline PFNGLACTIVETEXTUREPROC &originalActiveTexture() {
+  static PFNGLACTIVETEXTUREPROC pointer = NULL;
+  return pointer;
+}
+
+inline void APIENTRY countedUseProgram(GLuint program) {
+  GlCounterState &state = glCounters();
+  state.frame[GL_COUNT_PROGRAM_BINDS]++;
+  if (program == state.program)
+    state.frame[GL_COUNT_REDUNDANT_BINDS]++;
+  state.program = program;
+  originalUseProgram()(program);
+}
+
+inline void APIENTRY countedBindVertexArray(GLuint array) {
+  GlCounterState &state = glCounters();
+  state.frame[GL_COUNT_VAO_BINDS]++;
+  if (array == state.vertexArray)
+    state.frame[GL_COUNT_REDUNDANT_BINDS]++;
+  state.vertexArray = array;
+  originalBindVertexArray()(array);
+}
+
+inline void APIENTRY countedActiveTexture(GLenum texture) {
+  glCounters().activeTexture = texture - GL_TEXTURE0;
+  originalActiveTexture()(texture);
+}
+
+inline void APIENTRY countedBindTexture(GLenum target, GLuint texture) {
+  GlCounterState &state = glCounters();
+  state.frame[GL_COUNT_TEXTURE_BINDS]++;
+  if (target == GL_TEXTURE_2D && state.activeTexture < 32) {
+    if (texture == state.textures[state.activeTexture])
+      state.frame[GL_COUNT_REDUNDANT_BINDS]++;
+    state.textures[state.activeTexture] = texture;
+  }
+  originalBindTexture()(target, texture);
+}
+
+// call right after gladLoadGLLoader, before any GL state is set
+inline void installGlCounters() {
+  GlCounterState &state = glCounters();
+  if (state.installed)
+    return;
+  state.installed = true;
+
+  originalUseProgram() = glad_glUseProgram;
+  glad_glUseProgram = countedUseProgram;
+  originalBindVertexArray() = glad_glBindVertexArray;
+  glad_glBindVertexArray = countedBindVertexArray;
+  originalBindTexture() = glad_glBindTexture;
+  glad_glBindTexture = countedBindTexture;
+  originalActiveTexture() = glad_glActiveTexture;
+  glad_glActiveTexture = countedActiveTexture;
+
+  COUNT_GL_CALL(glDrawArrays, GL_COUNT_DRAWS);
+  COUNT_GL_CALL(glDrawElements, GL_COUNT_DRAWS);
+  COUNT_GL_CALL(glDrawRangeElements, GL_COUNT_DRAWS);
+  COUNT_GL_CALL(glDrawArraysInstanced, GL_COUNT_DRAWS);
+  COUNT_GL_CALL(glDrawElementsInstanced, GL_COUNT_DRAWS);
+  COUNT_GL_CALL(glDrawElementsBaseVertex, GL_COUNT_DRAWS);
+  COUNT_GL_CALL(glDrawRangeElementsBaseVertex, GL_COUNT_DRAWS);
+  COUNT_GL_CALL(glDrawElementsInstancedBaseVertex, GL_COUNT_DRAWS);
+  COUNT_GL_CALL(glMultiDrawArrays, GL_COUNT_DRAWS);
+  COUNT_GL_CALL(glMultiDrawElements, GL_COUNT_DRAWS);
+
+  COUNT_GL_CALL(glBufferData, GL_COUNT_BUFFER_UPLOADS);
+  COUNT_GL_CALL(glBufferSubData, GL_COUNT_BUFFER_UPLOADS);
+  COUNT_GL_CALL(glMapBuffer, GL_COUNT_BUFFER_UPLOADS);
+  COUNT_GL_CALL(glMapBufferRange, GL_COUNT_BUFFER_UPLOADS);
+
+  COUNT_GL_CALL(glUniform1f, GL_COUNT_UNIFORM_UPLOADS);
+  COUNT_GL_CALL(glUniform2f, GL_COUNT_UNIFORM_UPLOADS);
+  COUNT_GL_CALL(glUniform3f, GL_COUNT_UNIFORM_UPLOADS);
+  COUNT_GL_CALL(glUniform4f, GL_COUNT_UNIFORM_UPLOADS);
+  COUNT_GL_CALL(glUniform1i, GL_COUNT_UNIFORM_UPLOADS);
+  COUNT_GL_CALL(glUniform2i, GL_COUNT_UNIFORM_UPLOADS);
+  COUNT_GL_CALL(glUniform3i, GL_COUNT_UNIFORM_UPLOADS);
+  COUNT_GL_CALL(glUniform4i, GL_COUNT_UNIFORM_UPLOADS);
+  COUNT_GL_CALL(glUniform1ui, GL_COUNT_UNIFORM_UPLOADS);
+  COUNT_GL_CALL(glUniform2ui, GL_COUNT_UNIFORM_UPLOADS);
+  COUNT_GL_CALL(glUniform3ui, GL_COUNT_UNIFORM_UPLOADS);
+  COUNT_GL_CALL(glUniform4ui, GL_COUNT_UNIFORM_UPLOADS);
+  COUNT_GL_CALL(glUniform1fv, GL_COUNT_UNIFORM_UPLOADS);
+  COUNT_GL_CALL(glUniform2fv, GL_COUNT_UNIFORM_UPLOADS);
+  COUNT_GL_CALL(glUniform3fv, GL_COUNT_UNIFORM_UPLOADS);
+  COUNT_GL_CALL(glUniform4fv, GL_COUNT_UNIFORM_UPLOADS);
+  COUNT_GL_CALL(glUniform1iv, GL_COUNT_UNIFORM_UPLOADS);
+  COUNT_GL_CALL(glUniform2iv, GL_COUNT_UNIFORM_UPLOADS);
+  COUNT_GL_CALL(glUniform3iv, GL_COUNT_UNIFORM_UPLOADS);
+  COUNT_GL_CALL(glUniform4iv, GL_COUNT_UNIFORM_UPLOADS);
+  COUNT_GL_CALL(glUniform1uiv, GL_COUNT_UNIFORM_UPLOADS);
+  COUNT_GL_CALL(glUniform2uiv, GL_COUNT_UNIFORM_UPLOADS);
+  COUNT_GL_CALL(glUniform3uiv, GL_COUNT_UNIFORM_UPLOADS);
+  COUNT_GL_CALL(glUniform4uiv, GL_COUNT_UNIFORM_UPLOADS);
+  COUNT_GL_CALL(glUniformMatrix2fv, GL_COUNT_UNIFORM_UPLOADS);
+  COUNT_GL_CALL(glUniformMatrix3fv, GL_COUNT_UNIFORM_UPLOADS);
+  COUNT_GL_CALL(glUniformMatrix4fv, GL_COUNT_UNIFORM_UPLOADS);
+  COUNT_GL_CALL(glUniformMatrix2x3fv, GL_COUNT_UNIFORM_UPLOADS);
+  COUNT_GL_CALL(glUniformMatrix3x2fv, GL_COUNT_UNIFORM_UPLOADS);
+  COUNT_GL_CALL(glUniformMatrix2x4fv, GL_COUNT_UNIFORM_UPLOADS);
+  COUNT_GL_CALL(glUniformMatrix4x2fv, GL_COUNT_UNIFORM_UPLOADS);
+  COUNT_GL_CALL(glUniformMatrix3x4fv, GL_COUNT_UNIFORM_UPLOADS);
+  COUNT_GL_CALL(glUniformMatrix4x3fv, GL_COUNT_UNIFORM_UPLOADS);
+}
+
+inline void endGlCounterFrame() {
+  GlCounterState &state = glCounters();
+  if (!state.installed)
+    return;
+
+  for (int i = 0; i < GL_COUNTER_KINDS; i++) {
+    state.total[i] += state.frame[i];
+    state.max[i] = std::max(state.max[i], state.frame[i]);
+    state.frame[i] = 0;
+  }
+  state.frames++;
+}
+
+inline double glCounterAverage(GlCounter counter) {
+  const GlCounterState &state = glCounters();
+  return state.frames ? (double)state.total[counter] / state.frames : 0.0;
+}
+
+inline void printGlCounters() {
+  const GlCounterState &state = glCounters();
+  if (!state.installed || state.frames == 0)
+    return;
+
+  static const char *names[GL_COUNTER_KINDS] = {
+      "draw calls",     "program binds",   "VAO binds",     "texture binds",
+      "redundant binds", "uniform uploads", "buffer uploads"};
+  std::printf("GL calls per frame (%ld frames):\n", state.frames);
+  for (int i = 0; i < GL_COUNTER_KINDS; i++)
+    std::printf("  %-16s avg %.2f  max %ld\n", names[i],
+                glCounterAverage((GlCounter)i), state.max[i]);
+}
+
+#endif
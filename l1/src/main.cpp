@@ -3,44 +3,109 @@
 
 #include <iostream>
 
-int main() {
-  // inicjalizacja GLFW
-  glfwInit();
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-  // Tworzenie okna
+#include "bench.h"
+#include "headless.h"
+
+int main(int argc, char **argv) {
+  StartupProfile startup;
+  RunOptions options = parseRunOptions(argc, argv);
+
   const unsigned int window_width = 1000;
   const unsigned int window_height = 800;
-  GLFWwindow *window = glfwCreateWindow(window_width, window_height,
-                                        "grafika komputerowa", NULL, NULL);
-  if (window == NULL) {
-    std::cout << "Failed to create GLFW window" << std::endl;
-    glfwTerminate();
-    return -1;
+  GLFWwindow *window = NULL;
+  HeadlessContext headless;
+
+  if (options.headless) {
+    if (!createHeadlessContext(headless, window_width, window_height,
+                               options.debugOutput))
+      return -1;
+    markStartupPhase(startup, "egl context");
+  } else {
+    // inicjalizacja GLFW
+    glfwInit();
+    markStartupPhase(startup, "glfwInit");
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT,
+                   options.debugOutput ? GLFW_TRUE : GLFW_FALSE);
+
+    // Tworzenie okna
+    window = glfwCreateWindow(window_width, window_height,
+                              "grafika komputerowa", NULL, NULL);
+    if (window == NULL) {
+      std::cout << "Failed to create GLFW window" << std::endl;
+      glfwTerminate();
+      return -1;
+    }
+    glfwMakeContextCurrent(window);
+    markStartupPhase(startup, "window");
   }
-  glfwMakeContextCurrent(window);
 
   // inicjalizacja GLAD
-  if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+  GLADloadproc loader = options.headless ? (GLADloadproc)headlessGetProcAddress
+                                         : (GLADloadproc)glfwGetProcAddress;
+  if (!gladLoadGLLoader(loader)) {
     std::cout << "Failed to initialize GLAD" << std::endl;
     return -1;
   }
 
+  if (options.glCounters)
+    installGlCounters();
+  if (options.debugOutput)
+    enableDebugOutput(loader);
+
+  if (options.headless &&
+      !createHeadlessFramebuffer(headless, window_width, window_height))
+    return -1;
+  if (options.overdraw)
+    enableOverdraw();
+  markStartupPhase(startup, "glad");
+
   glViewport(0, 0, (GLuint)window_width, (GLuint)window_height);
 
+  FrameStats frameStats;
+  initFrameStats(frameStats);
+
+  GpuProfiler gpuProfiler;
+  gpuProfiler.enabled = options.gpuProfile || options.bench != NULL;
+
+  markStartupPhase(startup, "scene");
+  double cpuStart = processCpuTime();
+  double previousTime = runTime(window);
+
   // pętla zdarzeń
-  while (!glfwWindowShouldClose(window)) {
+  long frame = 0;
+  while (keepRunning(window, options, frame)) {
+    beginGpuFrame(gpuProfiler);
+    pushGpuScope(gpuProfiler, "frame");
+
     // renderowanie
     glClearColor(0.298f, 0.141f, 0.141f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT);
 
+    popGpuScope(gpuProfiler);
+    endGpuFrame(gpuProfiler);
+    endGlCounterFrame();
+
     //
-    glfwSwapBuffers(window);
-    glfwPollEvents();
+    presentFrame(window);
+    if (frame == 0)
+      markFirstFrame(startup);
+
+    double currentTime = runTime(window);
+    recordFrame(frameStats, currentTime - previousTime);
+    previousTime = currentTime;
+    frame++;
   }
 
-  glfwTerminate();
-  return 0;
+  bool passed = reportRun(options, "l1", 1, frameStats, gpuProfiler, startup,
+                          processCpuTime() - cpuStart);
+  destroyGpuProfiler(gpuProfiler);
+
+  if (options.headless)
+    destroyHeadlessContext(headless);
+  else
+    glfwTerminate();
+  return passed ? 0 : 1;
 }
\ No newline at end of file
@@ -0,0 +1,13 @@
+#version 330 core
+#ifdef VERTEX_COLOR
+in vec3 vertexColor;
+#endif
+out vec4 fragmentColor;
+void main()
+{
+#ifdef VERTEX_COLOR
+ fragmentColor = vec4(vertexColor, 1.0);
+#else
+ fragmentColor = vec4(0.3f, 0.0f, 0.51f, 1.0f);
+#endif
+}
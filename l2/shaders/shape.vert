@@ -0,0 +1,13 @@
+#version 330 core
+layout(location = 0) in vec3 position;
+#ifdef VERTEX_COLOR
+layout(location = 1) in vec3 color;
+out vec3 vertexColor;
+#endif
+void main()
+{
+ gl_Position = vec4(position.x, position.y, position.z, 1.0);
+#ifdef VERTEX_COLOR
+ vertexColor = color;
+#endif
+}
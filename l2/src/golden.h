@@ -0,0 +1,142 @@
+#ifndef GOLDEN_H
+#define GOLDEN_H
+
+#include <glad/glad.h>
+
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+// Golden-image checks for headless runs. The last frame is read back from the
+// offscreen framebuffer, box-filtered down by goldenDownsample (small
+// references, and single-pixel rasterization differences between drivers
+// average out) and stored as binary PPM. Two images match when at most
+// goldenMaxDiffPixels of the pixels differ by more than the tolerance in YIQ
+// space (the metric used by pixelmatch): 0 = exact, 1 = anything goes.
+const int goldenDownsample = 4;
+const double goldenMaxDiffPixels = 0.005;
+
+struct Image {
+  int width = 0;
+  int height = 0;
+  std::vector<unsigned char> rgb; // top row first
+};
+
+// reads the bound framebuffer (the FBO in headless runs) and downsamples it
+inline Image readFramebufferImage() {
+  GLint viewport[4];
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  int width = viewport[2], height = viewport[3];
+
+  std::vector<unsigned char> rgba((size_t)width * height * 4);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glReadPixels(viewport[0], viewport[1], width, height, GL_RGBA,
+               GL_UNSIGNED_BYTE, rgba.data());
+
+  Image image;
+  image.width = width / goldenDownsample;
+  image.height = height / goldenDownsample;
+  image.rgb.resize((size_t)image.width * image.height * 3);
+  const int samples = goldenDownsample * goldenDownsample;
+  for (int y = 0; y < image.height; y++) {
+    for (int x = 0; x < image.width; x++) {
+      int sum[3] = {0, 0, 0};
+      for (int sy = 0; sy < goldenDownsample; sy++) {
+        // GL rows start at the bottom
+        int row = height - 1 - (y * goldenDownsample + sy);
+        for (int sx = 0; sx < goldenDownsample; sx++) {
+          const unsigned char *pixel =
+              &rgba[((size_t)row * width + x * goldenDownsample + sx) * 4];
+          for (int c = 0; c < 3; c++)
+            sum[c] += pixel[c];
+        }
+      }
+      for (int c = 0; c < 3; c++)
+        image.rgb[((size_t)y * image.width + x) * 3 + c] =
+            (unsigned char)((sum[c] + samples / 2) / samples);
+    }
+  }
+  return image;
+}
+
+inline bool writePpm(const Image &image, const char *path) {
+  FILE *file = std::fopen(path, "wb");
+  if (file == NULL) {
+    std::cout << "Failed to write " << path << std::endl;
+    return false;
+  }
+  std::fprintf(file, "P6\n%d %d\n255\n", image.width, image.height);
+  std::fwrite(image.rgb.data(), 1, image.rgb.size(), file);
+  std::fclose(file);
+  return true;
+}
+
+inline bool readPpm(Image &image, const char *path) {
+  FILE *file = std::fopen(path, "rb");
+  if (file == NULL) {
+    std::cout << "Failed to read " << path << std::endl;
+    return false;
+  }
+
+  int maxValue = 0;
+  bool ok = std::fscanf(file, "P6 %d %d %d", &image.width, &image.height,
+                        &maxValue) == 3 &&
+            maxValue == 255 && image.width > 0 && image.height > 0 &&
+            std::fgetc(file) != EOF;
+  if (ok) {
+    image.rgb.resize((size_t)image.width * image.height * 3);
+    ok = std::fread(image.rgb.data(), 1, image.rgb.size(), file) ==
+         image.rgb.size();
+  }
+  std::fclose(file);
+
+  if (!ok)
+    std::cout << "Not a binary 8-bit PPM: " << path << std::endl;
+  return ok;
+}
+
+// squared YIQ distance normalized to 0..1
+inline double pixelDifference(const unsigned char *a, const unsigned char *b) {
+  double dr = a[0] - b[0], dg = a[1] - b[1], db = a[2] - b[2];
+  double y = dr * 0.29889531 + dg * 0.58662247 + db * 0.11448223;
+  double i = dr * 0.59597799 - dg * 0.27417610 - db * 0.32180189;
+  double q = dr * 0.21147017 - dg * 0.52261711 + db * 0.31114694;
+  return (0.5053 * y * y + 0.299 * i * i + 0.1957 * q * q) / 35215.0;
+}
+
+// fraction of pixels that differ by more than tolerance, 1 if sizes differ
+inline double imageDifference(const Image &a, const Image &b,
+                              double tolerance) {
+  if (a.width != b.width || a.height != b.height)
+    return 1.0;
+
+  const double threshold = tolerance * tolerance;
+  size_t pixels = (size_t)a.width * a.height, different = 0;
+  for (size_t i = 0; i < pixels; i++)
+    if (pixelDifference(&a.rgb[i * 3], &b.rgb[i * 3]) > threshold)
+      different++;
+  return pixels ? (double)different / pixels : 0.0;
+}
+
+// --capture writes the last frame, --golden compares it to a reference
+inline bool checkGoldenImage(const char *capturePath, const char *goldenPath,
+                             double tolerance) {
+  if (capturePath == NULL && goldenPath == NULL)
+    return true;
+
+  Image frame = readFramebufferImage();
+  bool ok = capturePath == NULL || writePpm(frame, capturePath);
+  if (goldenPath == NULL)
+    return ok;
+
+  Image golden;
+  if (!readPpm(golden, goldenPath))
+    return false;
+  double difference = imageDifference(frame, golden, tolerance);
+  bool match = difference <= goldenMaxDiffPixels;
+  std::printf("golden image %s: %.3f%% of pixels differ (%s)\n", goldenPath,
+              difference * 100.0, match ? "ok" : "FAILED");
+  return ok && match;
+}
+
+#endif
@@ -3,144 +3,89 @@
 
 #include <iostream>
 
-const GLchar *vertexShaderSource =
-    "#version 330 core\n"
-    "layout(location = 0) in vec3 position;\n"
-    "layout(location = 1) in vec3 color;\n"
-    "out vec3 vertexColor;\n"
-    "void main()\n"
-    "{\n"
-    " gl_Position = vec4(position.x, position.y, position.z, 1.0);\n"
-    " vertexColor = color;\n"
-    "}\0";
-
-const GLchar *fragmentShaderSource =
-    "#version 330 core\n"
-    "in vec3 vertexColor;\n"
-    "out vec4 fragmentColor;\n"
-    "void main()\n"
-    "{\n"
-    " fragmentColor = vec4(vertexColor, 1.0);\n"
-    "}\0";
-
-const GLchar *secondRecVertexShaderSource =
-    "#version 330 core\n"
-    "layout(location = 0) in vec3 position;\n"
-    "out vec3 vertexColor;\n"
-    "void main()\n"
-    "{\n"
-    " gl_Position = vec4(position.x, position.y, position.z, 1.0);\n"
-    " vertexColor = vec3(0.0f, 0.0f, 1.0f);\n"
-    "}\0";
-
-const GLchar *secondRecFragmentShaderSource =
-    "#version 330 core\n"
-    "out vec4 fragmentColor;\n"
-    "void main()\n"
-    "{\n"
-    " fragmentColor = vec4(0.3f, 0.0f, 0.51f, 1.0f);\n"
-    "}\0";
-
-int main() {
-  // inicjalizacja GLFW
-  glfwInit();
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-  // Tworzenie okna
+#include "bench.h"
+#include "headless.h"
+#include "index_buffer.h"
+#include "pipeline.h"
+#include "shader.h"
+#include "shader_files.h"
+#include "vertex_format.h"
+
+// shaders/shape.*: VERTEX_COLOR takes the color from the vertex data, without
+// it the rectangle is filled with a constant color
+enum ShapeFeature { VERTEX_COLOR = 1 << 0 };
+
+int main(int argc, char **argv) {
+  StartupProfile startup;
+  RunOptions options = parseRunOptions(argc, argv);
+
   const unsigned int window_width = 1000;
   const unsigned int window_height = 800;
-  GLFWwindow *window = glfwCreateWindow(window_width, window_height,
-                                        "grafika komputerowa", NULL, NULL);
-  if (window == NULL) {
-    std::cout << "Failed to create GLFW window" << std::endl;
-    glfwTerminate();
-    return -1;
+  GLFWwindow *window = NULL;
+  HeadlessContext headless;
+
+  if (options.headless) {
+    if (!createHeadlessContext(headless, window_width, window_height,
+                               options.debugOutput))
+      return -1;
+    markStartupPhase(startup, "egl context");
+  } else {
+    // inicjalizacja GLFW
+    glfwInit();
+    markStartupPhase(startup, "glfwInit");
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT,
+                   options.debugOutput ? GLFW_TRUE : GLFW_FALSE);
+
+    // Tworzenie okna
+    window = glfwCreateWindow(window_width, window_height,
+                              "grafika komputerowa", NULL, NULL);
+    if (window == NULL) {
+      std::cout << "Failed to create GLFW window" << std::endl;
+      glfwTerminate();
+      return -1;
+    }
+    glfwMakeContextCurrent(window);
+    markStartupPhase(startup, "window");
   }
-  glfwMakeContextCurrent(window);
 
   // inicjalizacja GLAD
-  if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+  GLADloadproc loader = options.headless ? (GLADloadproc)headlessGetProcAddress
+                                         : (GLADloadproc)glfwGetProcAddress;
+  if (!gladLoadGLLoader(loader)) {
     std::cout << "Failed to initialize GLAD" << std::endl;
     return -1;
   }
 
-  GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-  glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-  glCompileShader(vertexShader);
-
-  GLint status;
-  GLchar error_message[512];
-  glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &status);
-  if (!status) {
-    glGetShaderInfoLog(vertexShader, 512, NULL, error_message);
-    std::cout << "Error (Vertex shader): " << error_message << std::endl;
-  }
-
-  GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-  glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-  glCompileShader(fragmentShader);
-  glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &status);
-  if (!status) {
-    glGetShaderInfoLog(fragmentShader, 512, NULL, error_message);
-    std::cout << "Error (Fragment shader): " << error_message << std::endl;
-  }
-
-  GLuint secondRecVertexShader = glCreateShader(GL_VERTEX_SHADER);
-  glShaderSource(secondRecVertexShader, 1, &secondRecVertexShaderSource, NULL);
-  glCompileShader(secondRecVertexShader);
-
-  glGetShaderiv(secondRecVertexShader, GL_COMPILE_STATUS, &status);
-  if (!status) {
-    glGetShaderInfoLog(secondRecVertexShader, 512, NULL, error_message);
-    std::cout << "Error (Second rec vertex shader): " << error_message
-              << std::endl;
-  }
-
-  GLuint secondRecFragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-  glShaderSource(secondRecFragmentShader, 1, &secondRecFragmentShaderSource,
-                 NULL);
-  glCompileShader(secondRecFragmentShader);
-  glGetShaderiv(secondRecFragmentShader, GL_COMPILE_STATUS, &status);
-  if (!status) {
-    glGetShaderInfoLog(secondRecFragmentShader, 512, NULL, error_message);
-    std::cout << "Error (Second rec fragment shader): " << error_message
-              << std::endl;
-  }
-
-  GLuint shaderProgram = glCreateProgram();
-  glAttachShader(shaderProgram, vertexShader);
-  glAttachShader(shaderProgram, fragmentShader);
-  glLinkProgram(shaderProgram);
-
-  GLuint secondRecShaderProgram = glCreateProgram();
-  glAttachShader(secondRecShaderProgram, secondRecVertexShader);
-  glAttachShader(secondRecShaderProgram, secondRecFragmentShader);
-  glLinkProgram(secondRecShaderProgram);
-
-  glGetProgramiv(shaderProgram, GL_LINK_STATUS, &status);
-  if (!status) {
-    glGetProgramInfoLog(shaderProgram, 512, NULL, error_message);
-    std::cout << "Error (Shader program): " << error_message << std::endl;
-  }
-
-  glGetProgramiv(secondRecShaderProgram, GL_LINK_STATUS, &status);
-  if (!status) {
-    glGetProgramInfoLog(secondRecShaderProgram, 512, NULL, error_message);
-    std::cout << "Error (Second rec shader program): " << error_message
-              << std::endl;
-  }
-
-  glDetachShader(shaderProgram, vertexShader);
-  glDetachShader(shaderProgram, fragmentShader);
-  glDetachShader(secondRecShaderProgram, secondRecVertexShader);
-  glDetachShader(secondRecShaderProgram, secondRecFragmentShader);
-
-  glDeleteShader(vertexShader);
-  glDeleteShader(fragmentShader);
-  glDeleteShader(secondRecVertexShader);
-  glDeleteShader(secondRecFragmentShader);
+  if (options.glCounters)
+    installGlCounters();
+  if (options.debugOutput)
+    enableDebugOutput(loader);
+  initParallelShaderCompile(loader);
+  if (options.shaderCache != NULL)
+    initShaderCache(options.shaderCache, loader);
+  if (options.spirv != NULL || options.dumpShaders != NULL)
+    initSpirvShaders(options.spirv, options.dumpShaders, loader);
+  if (options.hotReload)
+    initShaderHotReload();
+
+  if (options.headless &&
+      !createHeadlessFramebuffer(headless, window_width, window_height))
+    return -1;
+  if (options.overdraw)
+    enableOverdraw();
+  markStartupPhase(startup, "glad");
+
+  ShaderVariants shapeShader =
+      shaderVariants(loadShaderFile("shape.vert"),
+                     loadShaderFile("shape.frag"), {"VERTEX_COLOR"});
+  watchShaderVariants(shapeShader, "shape.vert", "shape.frag");
+  // both variants are drawn every frame, so start compiling them now
+  submitShaderVariant(shapeShader, VERTEX_COLOR);
+  submitShaderVariant(shapeShader, 0);
+  markStartupPhase(startup, "shaders");
 
   // vertex data
   GLfloat vertices[] = {
@@ -169,22 +114,12 @@ int main() {
   glGenVertexArrays(1, &VAO);
   glBindVertexArray(VAO);
 
-  GLuint VBO;
-  glGenBuffers(1, &VBO);
-  glBindBuffer(GL_ARRAY_BUFFER, VBO);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-  GLuint EBO;
-  glGenBuffers(1, &EBO);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices,
-               GL_STATIC_DRAW);
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat),
-                        (void *)0);
-  glEnableVertexAttribArray(0);
-  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat),
-                        (void *)(3 * sizeof(GLfloat)));
-  glEnableVertexAttribArray(1);
+  // positions stay inside clip space, so snorm16 covers them
+  VertexFormat coloredFormat = vertexFormat(
+      {{0, 3, VERTEX_SNORM16}, {1, 3, VERTEX_UNORM8}});
+  GLuint VBO = createVertexBuffer(coloredFormat, vertices, 4);
+
+  IndexBuffer EBO = createIndexBuffer(indices, 6);
 
   glBindVertexArray(0);
 
@@ -192,51 +127,79 @@ int main() {
   glGenVertexArrays(1, &VAO2);
   glBindVertexArray(VAO2);
 
-  GLuint VBO2;
-  glGenBuffers(1, &VBO2);
-  glBindBuffer(GL_ARRAY_BUFFER, VBO2);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(vertices2), vertices2, GL_STATIC_DRAW);
+  GLuint VBO2 =
+      createVertexBuffer(vertexFormat({{0, 3, VERTEX_SNORM16}}), vertices2, 4);
 
-  GLuint EBO2;
-  glGenBuffers(1, &EBO2);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO2);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices2), indices2,
-               GL_STATIC_DRAW);
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat),
-                        (void *)0);
-  glEnableVertexAttribArray(0);
+  IndexBuffer EBO2 = createIndexBuffer(indices2, 6);
+
+  // the rectangles differ in shader variant and vertex layout only
+  PipelineState coloredState;
+  coloredState.shader = &shapeShader;
+  coloredState.features = VERTEX_COLOR;
+  coloredState.vertexArray = VAO;
+  Pipeline coloredPipeline = bakePipeline(coloredState);
+  PipelineState filledState;
+  filledState.shader = &shapeShader;
+  filledState.vertexArray = VAO2;
+  Pipeline filledPipeline = bakePipeline(filledState);
 
   glViewport(0, 0, (GLuint)window_width, (GLuint)window_height);
 
+  FrameStats frameStats;
+  initFrameStats(frameStats);
+
+  GpuProfiler gpuProfiler;
+  gpuProfiler.enabled = options.gpuProfile || options.bench != NULL;
+
+  markStartupPhase(startup, "scene");
+  double cpuStart = processCpuTime();
+  double previousTime = runTime(window);
+
   // pętla zdarzeń
-  while (!glfwWindowShouldClose(window)) {
+  long frame = 0;
+  while (keepRunning(window, options, frame)) {
+    pollShaderFiles();
+    beginGpuFrame(gpuProfiler);
+    pushGpuScope(gpuProfiler, "frame");
+
     glClearColor(0.18f, 0.2f, 0.22f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT);
 
-    glUseProgram(shaderProgram);
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
-    
-    glUseProgram(secondRecShaderProgram);
-    glBindVertexArray(VAO2);
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
-
-    glfwSwapBuffers(window);
-    glfwPollEvents();
+    applyPipeline(coloredPipeline);
+    drawIndexBuffer(GL_TRIANGLES, EBO);
+
+    applyPipeline(filledPipeline);
+    drawIndexBuffer(GL_TRIANGLES, EBO2);
+
+    popGpuScope(gpuProfiler);
+    endGpuFrame(gpuProfiler);
+    endGlCounterFrame();
+
+    presentFrame(window);
+    if (frame == 0)
+      markFirstFrame(startup);
+
+    double currentTime = runTime(window);
+    recordFrame(frameStats, currentTime - previousTime);
+    previousTime = currentTime;
+    frame++;
   }
 
+  bool passed = reportRun(options, "l2", 1, frameStats, gpuProfiler, startup,
+                          processCpuTime() - cpuStart);
+  destroyGpuProfiler(gpuProfiler);
+
   glDeleteVertexArrays(1, &VAO);
   glDeleteVertexArrays(1, &VAO2);
   glDeleteBuffers(1, &VBO);
   glDeleteBuffers(1, &VBO2);
-  glDeleteBuffers(1, &EBO);
-  glDeleteBuffers(1, &EBO2);
-  glDeleteProgram(shaderProgram);
-  glDeleteProgram(secondRecShaderProgram);
-  
-
-  glfwTerminate();
-  return 0;
+  deleteIndexBuffer(EBO);
+  deleteIndexBuffer(EBO2);
+  deleteShaderVariants(shapeShader);
+
+  if (options.headless)
+    destroyHeadlessContext(headless);
+  else
+    glfwTerminate();
+  return passed ? 0 : 1;
 }
\ No newline at end of file
@@ -3,88 +3,85 @@
 
 #include <iostream>
 
-const GLchar *vertexShaderSource =
-    "#version 330 core\n"
-    "layout(location = 0) in vec3 position;\n"
-    "layout(location = 1) in vec3 color;\n"
-    "out vec3 vertexColor;\n"
-    "void main()\n"
-    "{\n"
-    " gl_Position = vec4(position.x, position.y, position.z, 1.0);\n"
-    " vertexColor = color;\n"
-    "}\0";
-
-const GLchar *fragmentShaderSource =
-    "#version 330 core\n"
-    "in vec3 vertexColor;\n"
-    "out vec4 fragmentColor;\n"
-    "void main()\n"
-    "{\n"
-    " fragmentColor = vec4(vertexColor, 1.0);\n"
-    "}\0";
-
-int main() {
-  // inicjalizacja GLFW
-  glfwInit();
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-  // Tworzenie okna
+#include "bench.h"
+#include "headless.h"
+#include "index_buffer.h"
+#include "shader.h"
+#include "shader_files.h"
+#include "vertex_format.h"
+
+// shaders/shape.* with per-vertex color, the program main.cpp draws first
+enum ShapeFeature { VERTEX_COLOR = 1 << 0 };
+
+int main(int argc, char **argv) {
+  StartupProfile startup;
+  RunOptions options = parseRunOptions(argc, argv);
+
   const unsigned int window_width = 1000;
   const unsigned int window_height = 800;
-  GLFWwindow *window = glfwCreateWindow(window_width, window_height,
-                                        "grafika komputerowa", NULL, NULL);
-  if (window == NULL) {
-    std::cout << "Failed to create GLFW window" << std::endl;
-    glfwTerminate();
-    return -1;
+  GLFWwindow *window = NULL;
+  HeadlessContext headless;
+
+  if (options.headless) {
+    if (!createHeadlessContext(headless, window_width, window_height,
+                               options.debugOutput))
+      return -1;
+    markStartupPhase(startup, "egl context");
+  } else {
+    // inicjalizacja GLFW
+    glfwInit();
+    markStartupPhase(startup, "glfwInit");
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT,
+                   options.debugOutput ? GLFW_TRUE : GLFW_FALSE);
+
+    // Tworzenie okna
+    window = glfwCreateWindow(window_width, window_height,
+                              "grafika komputerowa", NULL, NULL);
+    if (window == NULL) {
+      std::cout << "Failed to create GLFW window" << std::endl;
+      glfwTerminate();
+      return -1;
+    }
+    glfwMakeContextCurrent(window);
+    markStartupPhase(startup, "window");
   }
-  glfwMakeContextCurrent(window);
 
   // inicjalizacja GLAD
-  if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+  GLADloadproc loader = options.headless ? (GLADloadproc)headlessGetProcAddress
+                                         : (GLADloadproc)glfwGetProcAddress;
+  if (!gladLoadGLLoader(loader)) {
     std::cout << "Failed to initialize GLAD" << std::endl;
     return -1;
   }
 
-  GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-  glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-  glCompileShader(vertexShader);
-
-  GLint status;
-  GLchar error_message[512];
-  glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &status);
-  if (!status) {
-    glGetShaderInfoLog(vertexShader, 512, NULL, error_message);
-    std::cout << "Error (Vertex shader): " << error_message << std::endl;
-  }
-
-  GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-  glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-  glCompileShader(fragmentShader);
-  glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &status);
-  if (!status) {
-    glGetShaderInfoLog(fragmentShader, 512, NULL, error_message);
-    std::cout << "Error (Fragment shader): " << error_message << std::endl;
-  }
-
-  GLuint shaderProgram = glCreateProgram();
-  glAttachShader(shaderProgram, vertexShader);
-  glAttachShader(shaderProgram, fragmentShader);
-  glLinkProgram(shaderProgram);
-
-  glGetProgramiv(shaderProgram, GL_LINK_STATUS, &status);
-  if (!status) {
-    glGetProgramInfoLog(shaderProgram, 512, NULL, error_message);
-    std::cout << "Error (Shader program): " << error_message << std::endl;
-  }
-
-  glDetachShader(shaderProgram, vertexShader);
-  glDetachShader(shaderProgram, fragmentShader);
+  if (options.glCounters)
+    installGlCounters();
+  if (options.debugOutput)
+    enableDebugOutput(loader);
+  initParallelShaderCompile(loader);
+  if (options.shaderCache != NULL)
+    initShaderCache(options.shaderCache, loader);
+  if (options.spirv != NULL || options.dumpShaders != NULL)
+    initSpirvShaders(options.spirv, options.dumpShaders, loader);
+  if (options.hotReload)
+    initShaderHotReload();
+
+  if (options.headless &&
+      !createHeadlessFramebuffer(headless, window_width, window_height))
+    return -1;
+  if (options.overdraw)
+    enableOverdraw();
+  markStartupPhase(startup, "glad");
 
-  glDeleteShader(vertexShader);
-  glDeleteShader(fragmentShader);
+  ShaderVariants shapeShader =
+      shaderVariants(loadShaderFile("shape.vert"),
+                     loadShaderFile("shape.frag"), {"VERTEX_COLOR"});
+  watchShaderVariants(shapeShader, "shape.vert", "shape.frag");
+  submitShaderVariant(shapeShader, VERTEX_COLOR);
+  markStartupPhase(startup, "shaders");
 
   // vertex data
   GLfloat vertices[] = {
@@ -100,47 +97,69 @@ int main() {
   glGenVertexArrays(1, &VAO);
   glBindVertexArray(VAO);
 
-  GLuint VBO;
-  glGenBuffers(1, &VBO);
-  glBindBuffer(GL_ARRAY_BUFFER, VBO);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-  GLuint EBO;
-  glGenBuffers(1, &EBO);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices,
-               GL_STATIC_DRAW);
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat),
-                        (void *)0);
-  glEnableVertexAttribArray(0);
-  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat),
-                        (void *)(3 * sizeof(GLfloat)));
-  glEnableVertexAttribArray(1);
+  GLuint VBO = createVertexBuffer(
+      vertexFormat({{0, 3, VERTEX_SNORM16}, {1, 3, VERTEX_UNORM8}}), vertices,
+      4);
+
+  IndexBuffer EBO = createIndexBuffer(
+      indices, sizeof(indices) / sizeof(indices[0]), 2);
 
   glBindVertexArray(0);
 
   glViewport(0, 0, (GLuint)window_width, (GLuint)window_height);
 
+  FrameStats frameStats;
+  initFrameStats(frameStats);
+
+  GpuProfiler gpuProfiler;
+  gpuProfiler.enabled = options.gpuProfile || options.bench != NULL;
+
+  shaderVariant(shapeShader, VERTEX_COLOR);
+  markStartupPhase(startup, "scene");
+  double cpuStart = processCpuTime();
+  double previousTime = runTime(window);
+
   // pętla zdarzeń
-  while (!glfwWindowShouldClose(window)) {
+  long frame = 0;
+  while (keepRunning(window, options, frame)) {
+    pollShaderFiles();
+    beginGpuFrame(gpuProfiler);
+    pushGpuScope(gpuProfiler, "frame");
+
     glClearColor(0.18f, 0.2f, 0.22f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT);
 
-    glUseProgram(shaderProgram);
+    glUseProgram(shaderVariant(shapeShader, VERTEX_COLOR).program);
     glBindVertexArray(VAO);
-    glDrawElements(GL_LINES, sizeof(indices) / sizeof(indices[0]),
-                   GL_UNSIGNED_INT, 0);
+    drawIndexBuffer(GL_LINES, EBO);
     glBindVertexArray(0);
 
-    glfwSwapBuffers(window);
-    glfwPollEvents();
+    popGpuScope(gpuProfiler);
+    endGpuFrame(gpuProfiler);
+    endGlCounterFrame();
+
+    presentFrame(window);
+    if (frame == 0)
+      markFirstFrame(startup);
+
+    double currentTime = runTime(window);
+    recordFrame(frameStats, currentTime - previousTime);
+    previousTime = currentTime;
+    frame++;
   }
 
+  bool passed = reportRun(options, "l2-main2", 1, frameStats, gpuProfiler,
+                          startup, processCpuTime() - cpuStart);
+  destroyGpuProfiler(gpuProfiler);
+
   glDeleteVertexArrays(1, &VAO);
   glDeleteBuffers(1, &VBO);
-  glDeleteBuffers(1, &EBO);
-  glDeleteProgram(shaderProgram);
+  deleteIndexBuffer(EBO);
+  deleteShaderVariants(shapeShader);
 
-  glfwTerminate();
-  return 0;
+  if (options.headless)
+    destroyHeadlessContext(headless);
+  else
+    glfwTerminate();
+  return passed ? 0 : 1;
 }
\ No newline at end of file
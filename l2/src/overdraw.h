@@ -0,0 +1,188 @@
+#ifndef OVERDRAW_H
+#define OVERDRAW_H
+
+#include <glad/glad.h>
+
+#include <cstdio>
+#include <vector>
+
+// --overdraw: every fragment that passes the depth test increments the
+// stencil buffer (the integer counting target; 8 bits, saturates at 255), so
+// after the scene each pixel holds how many fragments were shaded for it.
+// The frame is then replaced by a heat map of those counts and the counts are
+// read back for the summary printed on exit: fragments per frame and their
+// ratio to the screen pixels. Fragments rejected by the depth test are not
+// counted, which is what drawing front to back or culling saves.
+//
+// Stencil state is not part of the labs' pipelines, so counting leaves the
+// scene's own state alone; the heat map pass restores what it changes.
+const int overdrawLevels = 8; // heat map colors; the last one means ">= 8"
+
+struct OverdrawState {
+  bool enabled = false;
+  GLuint program = 0;
+  GLint colorLocation = -1;
+  GLuint vertexArray = 0;
+  long frames = 0;
+  double fragments = 0.0;
+  double pixels = 0.0;
+  int maxLayers = 0;
+  std::vector<double> histogram; // pixels with 0, 1, ... >= levels-1 layers
+};
+
+inline OverdrawState &overdraw() {
+  static OverdrawState state;
+  return state;
+}
+
+// full-screen triangle from gl_VertexID, no vertex data needed
+const GLchar *const overdrawVertexSource =
+    "#version 330 core\n"
+    "void main()\n"
+    "{\n"
+    "    vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+    "    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);\n"
+    "}\n";
+
+const GLchar *const overdrawFragmentSource =
+    "#version 330 core\n"
+    "uniform vec3 color;\n"
+    "out vec4 fragmentColor;\n"
+    "void main()\n"
+    "{\n"
+    "    fragmentColor = vec4(color, 1.0);\n"
+    "}\n";
+
+// black for nothing drawn, then blue -> green -> yellow -> red -> white
+const GLfloat overdrawColors[overdrawLevels][3] = {
+    {0.0f, 0.0f, 0.0f}, {0.0f, 0.1f, 0.6f}, {0.0f, 0.5f, 0.5f},
+    {0.1f, 0.7f, 0.1f}, {0.8f, 0.8f, 0.0f}, {0.9f, 0.4f, 0.0f},
+    {0.9f, 0.0f, 0.0f}, {1.0f, 1.0f, 1.0f}};
+
+inline bool overdrawDefaultFramebuffer() {
+  GLint framebuffer = 0;
+  glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+  return framebuffer == 0;
+}
+
+inline void countOverdraw() {
+  glEnable(GL_STENCIL_TEST);
+  glStencilMask(0xFF);
+  glStencilFunc(GL_ALWAYS, 0, 0xFF);
+  glStencilOp(GL_KEEP, GL_KEEP, GL_INCR);
+}
+
+// call once the framebuffer the lab renders to is bound (after
+// createHeadlessFramebuffer in headless runs)
+inline bool enableOverdraw() {
+  GLint stencilBits = 0;
+  glGetFramebufferAttachmentParameteriv(
+      GL_DRAW_FRAMEBUFFER,
+      overdrawDefaultFramebuffer() ? GL_STENCIL : GL_STENCIL_ATTACHMENT,
+      GL_FRAMEBUFFER_ATTACHMENT_STENCIL_SIZE, &stencilBits);
+  if (stencilBits == 0) {
+    std::printf("No stencil buffer, --overdraw ignored\n");
+    return false;
+  }
+
+  OverdrawState &state = overdraw();
+  GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
+  glShaderSource(vertexShader, 1, &overdrawVertexSource, NULL);
+  glCompileShader(vertexShader);
+  GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+  glShaderSource(fragmentShader, 1, &overdrawFragmentSource, NULL);
+  glCompileShader(fragmentShader);
+  state.program = glCreateProgram();
+  glAttachShader(state.program, vertexShader);
+  glAttachShader(state.program, fragmentShader);
+  glLinkProgram(state.program);
+  glDeleteShader(vertexShader);
+  glDeleteShader(fragmentShader);
+  state.colorLocation = glGetUniformLocation(state.program, "color");
+  glGenVertexArrays(1, &state.vertexArray);
+  state.histogram.assign(overdrawLevels, 0.0);
+
+  glClear(GL_STENCIL_BUFFER_BIT);
+  countOverdraw();
+  state.enabled = true;
+  return true;
+}
+
+// reads the counts, draws the heat map over the frame and clears the counts
+// for the next one; presentFrame calls it
+inline void endOverdrawFrame() {
+  OverdrawState &state = overdraw();
+  if (!state.enabled)
+    return;
+
+  GLint viewport[4];
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  std::vector<unsigned char> layers((size_t)viewport[2] * viewport[3]);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glReadPixels(viewport[0], viewport[1], viewport[2], viewport[3],
+               GL_STENCIL_INDEX, GL_UNSIGNED_BYTE, layers.data());
+  double fragments = 0.0;
+  for (unsigned char count : layers) {
+    fragments += count;
+    if (count > state.maxLayers)
+      state.maxLayers = count;
+    state.histogram[count < overdrawLevels ? count : overdrawLevels - 1]++;
+  }
+  state.fragments += fragments;
+  state.pixels += (double)layers.size();
+  state.frames++;
+
+  // heat map: one full-screen pass per level, picked by the stencil test
+  GLint program, vertexArray;
+  glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+  glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &vertexArray);
+  GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+  GLboolean blend = glIsEnabled(GL_BLEND);
+  GLboolean cullFace = glIsEnabled(GL_CULL_FACE);
+  glDisable(GL_DEPTH_TEST);
+  glDisable(GL_BLEND);
+  glDisable(GL_CULL_FACE);
+  glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+  glUseProgram(state.program);
+  glBindVertexArray(state.vertexArray);
+  for (int level = 0; level < overdrawLevels; level++) {
+    // the last level takes everything from there up (ref <= stencil)
+    glStencilFunc(level == overdrawLevels - 1 ? GL_LEQUAL : GL_EQUAL, level,
+                  0xFF);
+    glUniform3fv(state.colorLocation, 1, overdrawColors[level]);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+  }
+
+  glUseProgram((GLuint)program);
+  glBindVertexArray((GLuint)vertexArray);
+  if (depthTest)
+    glEnable(GL_DEPTH_TEST);
+  if (blend)
+    glEnable(GL_BLEND);
+  if (cullFace)
+    glEnable(GL_CULL_FACE);
+  glClear(GL_STENCIL_BUFFER_BIT);
+  countOverdraw();
+}
+
+inline void printOverdraw() {
+  const OverdrawState &state = overdraw();
+  if (!state.enabled || state.frames == 0)
+    return;
+
+  // 1.00 per covered pixel means nothing is shaded twice: sorting front to
+  // back or culling has nothing left to save
+  double covered = state.pixels - state.histogram[0];
+  std::printf("overdraw: %.0f fragments per frame, %.2fx the %.0f screen "
+              "pixels, %.2f per covered pixel, max %d layers\n",
+              state.fragments / state.frames, state.fragments / state.pixels,
+              state.pixels / state.frames,
+              covered > 0 ? state.fragments / covered : 0.0, state.maxLayers);
+  std::printf("  pixels by layers:");
+  for (int level = 0; level < overdrawLevels; level++)
+    std::printf(" %d%s %.1f%%", level, level == overdrawLevels - 1 ? "+" : ":",
+                100.0 * state.histogram[level] / state.pixels);
+  std::printf("\n");
+}
+
+#endif
@@ -0,0 +1,788 @@
+#ifndef SHADER_H
+#define SHADER_H
+
+#include <glad/glad.h>
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+// Shader compile/link shared by the labs, with an optional on-disk cache of
+// linked program binaries (--shader-cache DIR). The cache key hashes both
+// sources together with the GL vendor, renderer and version strings, so a
+// driver update never loads a stale binary; if glProgramBinary still refuses
+// a file the program is compiled from source and the file rewritten.
+//
+// Programs are built in two steps. submitProgram() issues compile and link
+// and returns at once; finishProgram() checks the status, prints the logs
+// and saves the binary, and is called right before the program is first
+// used. Drivers compile in the background meanwhile (with
+// KHR_parallel_shader_compile on several threads), so texture decode and
+// buffer setup overlap with shader compilation.
+//
+// With --spirv DIR, stages that were compiled offline (spirv.sh) are loaded
+// as SPIR-V through ARB_gl_spirv, skipping the GLSL front end. The .spv files
+// are keyed by a hash of the GLSL text, so an edited shader, a permutation
+// that was never dumped or a driver without the extension simply compiles
+// the GLSL string as before.
+//
+// glad only covers core 3.3, so the ARB_get_program_binary,
+// KHR_parallel_shader_compile and ARB_gl_spirv entry points are loaded by
+// hand.
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+#ifndef GL_SHADER_BINARY_FORMAT_SPIR_V_ARB
+#define GL_SHADER_BINARY_FORMAT_SPIR_V_ARB 0x9551
+#endif
+
+typedef void(APIENTRYP GetProgramBinaryProc)(GLuint program, GLsizei bufSize,
+                                             GLsizei *length,
+                                             GLenum *binaryFormat,
+                                             void *binary);
+typedef void(APIENTRYP ProgramBinaryProc)(GLuint program, GLenum binaryFormat,
+                                          const void *binary, GLsizei length);
+typedef void(APIENTRYP ProgramParameteriProc)(GLuint program, GLenum pname,
+                                              GLint value);
+typedef void(APIENTRYP MaxShaderCompilerThreadsProc)(GLuint count);
+typedef void(APIENTRYP ShaderBinaryProc)(GLsizei count, const GLuint *shaders,
+                                         GLenum binaryFormat,
+                                         const void *binary, GLsizei length);
+typedef void(APIENTRYP SpecializeShaderProc)(GLuint shader,
+                                             const GLchar *entryPoint,
+                                             GLuint constantCount,
+                                             const GLuint *constantIndex,
+                                             const GLuint *constantValue);
+
+struct ShaderCacheState {
+  bool enabled = false;
+  std::string directory;
+  std::string driver; // vendor, renderer and version, part of every key
+  GetProgramBinaryProc getProgramBinary = NULL;
+  ProgramBinaryProc programBinary = NULL;
+  ProgramParameteriProc programParameteri = NULL;
+  long hits = 0;
+  long misses = 0;
+};
+
+inline ShaderCacheState &shaderCache() {
+  static ShaderCacheState state;
+  return state;
+}
+
+struct SpirvState {
+  bool enabled = false;     // load .spv files from directory
+  std::string directory;
+  std::string dumpDirectory; // write GLSL stages here for spirv.sh
+  ShaderBinaryProc shaderBinary = NULL;
+  SpecializeShaderProc specializeShader = NULL;
+  long programs = 0;  // linked from SPIR-V
+  long fallbacks = 0; // had .spv files but ended up compiled from GLSL
+};
+
+inline SpirvState &spirvShaders() {
+  static SpirvState state;
+  return state;
+}
+
+// submitted programs whose status has not been checked yet
+struct PendingProgram {
+  GLuint program;
+  GLuint vertexShader;
+  GLuint fragmentShader;
+  std::string name;
+  std::string cachePath;
+  bool spirv; // stages came from SPIR-V; the GLSL is kept for the fallback
+  std::string vertexSource;
+  std::string fragmentSource;
+};
+
+struct ShaderCompilerState {
+  bool parallel = false; // GL_COMPLETION_STATUS_KHR can be polled
+  std::vector<PendingProgram> pending;
+};
+
+inline ShaderCompilerState &shaderCompiler() {
+  static ShaderCompilerState state;
+  return state;
+}
+
+inline bool hasExtension(const char *name) {
+  GLint count = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+  for (GLint i = 0; i < count; i++)
+    if (std::strcmp((const char *)glGetStringi(GL_EXTENSIONS, i), name) == 0)
+      return true;
+  return false;
+}
+
+// call after gladLoadGLLoader; lets the driver use all its compiler threads
+inline bool initParallelShaderCompile(GLADloadproc load) {
+  const char *function = NULL;
+  if (hasExtension("GL_KHR_parallel_shader_compile"))
+    function = "glMaxShaderCompilerThreadsKHR";
+  else if (hasExtension("GL_ARB_parallel_shader_compile"))
+    function = "glMaxShaderCompilerThreadsARB";
+  MaxShaderCompilerThreadsProc maxThreads =
+      function ? (MaxShaderCompilerThreadsProc)load(function) : NULL;
+  if (maxThreads == NULL)
+    return false;
+
+  maxThreads(0xFFFFFFFFu); // implementation-defined maximum
+  shaderCompiler().parallel = true;
+  return true;
+}
+
+// call after gladLoadGLLoader with the same loader
+inline bool initShaderCache(const char *directory, GLADloadproc load) {
+  ShaderCacheState &cache = shaderCache();
+  cache.getProgramBinary = (GetProgramBinaryProc)load("glGetProgramBinary");
+  cache.programBinary = (ProgramBinaryProc)load("glProgramBinary");
+  cache.programParameteri = (ProgramParameteriProc)load("glProgramParameteri");
+
+  GLint formats = 0;
+  if (cache.getProgramBinary != NULL)
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+  if (cache.programBinary == NULL || cache.programParameteri == NULL ||
+      formats == 0) {
+    std::cout << "Program binaries are not supported, shader cache disabled"
+              << std::endl;
+    return false;
+  }
+
+  std::error_code error;
+  std::filesystem::create_directories(directory, error);
+  if (error) {
+    std::cout << "Failed to create shader cache " << directory << std::endl;
+    return false;
+  }
+
+  cache.directory = directory;
+  cache.driver = std::string((const char *)glGetString(GL_VENDOR)) + '\n' +
+                 (const char *)glGetString(GL_RENDERER) + '\n' +
+                 (const char *)glGetString(GL_VERSION);
+  cache.enabled = true;
+  return true;
+}
+
+// Call after gladLoadGLLoader. directory holds <hash>.vert.spv and
+// <hash>.frag.spv files; dumpDirectory receives the matching GLSL stages
+// (<hash>.vert, <hash>.frag) that spirv.sh compiles. Either may be NULL.
+inline bool initSpirvShaders(const char *directory, const char *dumpDirectory,
+                             GLADloadproc load) {
+  SpirvState &spirv = spirvShaders();
+  if (dumpDirectory != NULL) {
+    std::error_code error;
+    std::filesystem::create_directories(dumpDirectory, error);
+    if (error)
+      std::cout << "Failed to create " << dumpDirectory << std::endl;
+    else
+      spirv.dumpDirectory = dumpDirectory;
+  }
+  if (directory == NULL)
+    return false;
+
+  // core in 4.6; glShaderBinary itself is core in 4.1
+  if (hasExtension("GL_ARB_gl_spirv")) {
+    spirv.shaderBinary = (ShaderBinaryProc)load("glShaderBinary");
+    spirv.specializeShader =
+        (SpecializeShaderProc)load("glSpecializeShaderARB");
+    if (spirv.specializeShader == NULL)
+      spirv.specializeShader = (SpecializeShaderProc)load("glSpecializeShader");
+  }
+  if (spirv.shaderBinary == NULL || spirv.specializeShader == NULL) {
+    std::cout << "GL_ARB_gl_spirv is not supported, shaders compile from GLSL"
+              << std::endl;
+    return false;
+  }
+
+  spirv.directory = directory;
+  spirv.enabled = true;
+  return true;
+}
+
+// FNV-1a
+inline unsigned long long hashText(const std::string &text,
+                                   unsigned long long hash =
+                                       1469598103934665603ULL) {
+  for (unsigned char c : text) {
+    hash ^= c;
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+inline std::string shaderCachePath(const GLchar *vertexSource,
+                                   const GLchar *fragmentSource) {
+  const ShaderCacheState &cache = shaderCache();
+  unsigned long long hash = hashText(cache.driver);
+  hash = hashText(vertexSource, hashText(std::string(1, '\0'), hash));
+  hash = hashText(fragmentSource, hashText(std::string(1, '\0'), hash));
+
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016llx.bin", hash);
+  return cache.directory + "/" + name;
+}
+
+// file: binary format (GLenum) followed by the binary
+inline GLuint loadCachedProgram(const std::string &path) {
+  FILE *file = std::fopen(path.c_str(), "rb");
+  if (file == NULL)
+    return 0;
+
+  GLenum format = 0;
+  std::vector<char> binary;
+  if (std::fread(&format, sizeof(format), 1, file) == 1) {
+    char buffer[4096];
+    size_t read;
+    while ((read = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+      binary.insert(binary.end(), buffer, buffer + read);
+  }
+  std::fclose(file);
+  if (binary.empty())
+    return 0;
+
+  GLuint program = glCreateProgram();
+  shaderCache().programBinary(program, format, binary.data(),
+                              (GLsizei)binary.size());
+  GLint status = 0;
+  glGetProgramiv(program, GL_LINK_STATUS, &status);
+  if (!status) {
+    glDeleteProgram(program);
+    return 0;
+  }
+  return program;
+}
+
+inline void storeCachedProgram(const std::string &path, GLuint program) {
+  GLint length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0)
+    return;
+
+  std::vector<char> binary(length);
+  GLenum format = 0;
+  shaderCache().getProgramBinary(program, length, NULL, &format,
+                                 binary.data());
+
+  // write then rename, so a crash never leaves a truncated binary behind
+  std::string temporary = path + ".tmp";
+  FILE *file = std::fopen(temporary.c_str(), "wb");
+  if (file == NULL)
+    return;
+  bool ok = std::fwrite(&format, sizeof(format), 1, file) == 1 &&
+            std::fwrite(binary.data(), 1, binary.size(), file) ==
+                binary.size();
+  ok = std::fclose(file) == 0 && ok;
+
+  std::error_code error;
+  if (ok)
+    std::filesystem::rename(temporary, path, error);
+  if (!ok || error)
+    std::filesystem::remove(temporary, error);
+}
+
+// <hash of the GLSL stage>.<stage>, shared by the dump and the .spv lookup
+inline std::string spirvStageName(const GLchar *source, const char *stage) {
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016llx.%s", hashText(source), stage);
+  return name;
+}
+
+inline void dumpShaderStage(const GLchar *source, const char *stage) {
+  const SpirvState &spirv = spirvShaders();
+  if (spirv.dumpDirectory.empty())
+    return;
+
+  std::string path =
+      spirv.dumpDirectory + "/" + spirvStageName(source, stage);
+  FILE *file = std::fopen(path.c_str(), "wb");
+  if (file == NULL)
+    return;
+  std::fputs(source, file);
+  std::fclose(file);
+}
+
+// shader object from <hash>.<stage>.spv, or 0 when there is no usable file;
+// found is set when the file exists
+inline GLuint loadSpirvStage(GLenum type, const GLchar *source,
+                             const char *stage, bool &found) {
+  const SpirvState &spirv = spirvShaders();
+  std::string path =
+      spirv.directory + "/" + spirvStageName(source, stage) + ".spv";
+  FILE *file = std::fopen(path.c_str(), "rb");
+  if (file == NULL)
+    return 0;
+  found = true;
+  std::vector<char> binary;
+  char buffer[4096];
+  size_t read;
+  while ((read = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+    binary.insert(binary.end(), buffer, buffer + read);
+  std::fclose(file);
+  if (binary.empty())
+    return 0;
+
+  GLuint shader = glCreateShader(type);
+  spirv.shaderBinary(1, &shader, GL_SHADER_BINARY_FORMAT_SPIR_V_ARB,
+                     binary.data(), (GLsizei)binary.size());
+  // the lab shaders declare no constant_id, every constant keeps its default
+  spirv.specializeShader(shader, "main", 0, NULL, NULL);
+  GLint status = GL_FALSE;
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+  if (!status) {
+    glDeleteShader(shader);
+    return 0;
+  }
+  return shader;
+}
+
+inline GLuint compileShader(GLenum type, const GLchar *source) {
+  GLuint shader = glCreateShader(type);
+  glShaderSource(shader, 1, &source, NULL);
+  glCompileShader(shader);
+  return shader;
+}
+
+inline std::string shaderInfoLog(GLuint shader) {
+  GLint length = 0;
+  glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+  std::string log(length > 0 ? length : 1, '\0');
+  glGetShaderInfoLog(shader, (GLsizei)log.size(), NULL, &log[0]);
+  return log.c_str();
+}
+
+inline std::string programInfoLog(GLuint program) {
+  GLint length = 0;
+  glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+  std::string log(length > 0 ? length : 1, '\0');
+  glGetProgramInfoLog(program, (GLsizei)log.size(), NULL, &log[0]);
+  return log.c_str();
+}
+
+// Issues compile and link of a vertex + fragment program without waiting
+// for either; name labels the error messages printed by finishProgram
+// ("Shader program" -> "Error (Shader program, vertex shader)").
+inline GLuint submitProgram(const GLchar *vertexSource,
+                            const GLchar *fragmentSource,
+                            const char *name = "Shader program") {
+  // before the cache lookup, so a warm cache still dumps every stage
+  dumpShaderStage(vertexSource, "vert");
+  dumpShaderStage(fragmentSource, "frag");
+
+  ShaderCacheState &cache = shaderCache();
+  std::string cachePath;
+  if (cache.enabled) {
+    cachePath = shaderCachePath(vertexSource, fragmentSource);
+    GLuint program = loadCachedProgram(cachePath);
+    if (program != 0) {
+      cache.hits++;
+      return program;
+    }
+    cache.misses++;
+  }
+
+  PendingProgram pending;
+  pending.spirv = false;
+  if (spirvShaders().enabled) {
+    bool found = false;
+    pending.vertexShader =
+        loadSpirvStage(GL_VERTEX_SHADER, vertexSource, "vert", found);
+    pending.fragmentShader =
+        loadSpirvStage(GL_FRAGMENT_SHADER, fragmentSource, "frag", found);
+    pending.spirv = pending.vertexShader != 0 && pending.fragmentShader != 0;
+    if (!pending.spirv) {
+      if (pending.vertexShader != 0)
+        glDeleteShader(pending.vertexShader);
+      if (pending.fragmentShader != 0)
+        glDeleteShader(pending.fragmentShader);
+      if (found)
+        spirvShaders().fallbacks++;
+    }
+  }
+  if (pending.spirv) {
+    pending.vertexSource = vertexSource;
+    pending.fragmentSource = fragmentSource;
+  } else {
+    pending.vertexShader = compileShader(GL_VERTEX_SHADER, vertexSource);
+    pending.fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
+  }
+
+  pending.program = glCreateProgram();
+  if (cache.enabled)
+    cache.programParameteri(pending.program,
+                            GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  glAttachShader(pending.program, pending.vertexShader);
+  glAttachShader(pending.program, pending.fragmentShader);
+  glLinkProgram(pending.program);
+
+  pending.name = name;
+  pending.cachePath = cachePath;
+  shaderCompiler().pending.push_back(pending);
+  return pending.program;
+}
+
+// true when finishProgram would not block; without parallel compile support
+// there is no way to ask, so only finished programs report true
+inline bool programCompleted(GLuint program) {
+  const ShaderCompilerState &compiler = shaderCompiler();
+  for (const PendingProgram &pending : compiler.pending) {
+    if (pending.program != program)
+      continue;
+    if (!compiler.parallel)
+      return false;
+    GLint completed = GL_FALSE;
+    glGetProgramiv(program, GL_COMPLETION_STATUS_KHR, &completed);
+    return completed == GL_TRUE;
+  }
+  return true;
+}
+
+// ARB_gl_spirv does not require drivers to keep names, but the labs look up
+// uniforms and blocks by name; true when every lookup would work
+inline bool programNamesResolve(GLuint program) {
+  GLint count = 0, maxLength = 0;
+  glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+  glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+  std::vector<GLchar> name(maxLength > 0 ? maxLength : 1);
+  for (GLint i = 0; i < count; i++) {
+    GLuint index = (GLuint)i;
+    GLint block = -1, size;
+    GLenum type;
+    GLsizei length = 0;
+    glGetActiveUniform(program, index, (GLsizei)name.size(), &length, &size,
+                       &type, name.data());
+    glGetActiveUniformsiv(program, 1, &index, GL_UNIFORM_BLOCK_INDEX, &block);
+    if (length == 0 ||
+        (block < 0 && glGetUniformLocation(program, name.data()) < 0))
+      return false;
+  }
+
+  glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+  glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxLength);
+  name.resize(maxLength > 0 ? maxLength : 1);
+  for (GLint i = 0; i < count; i++) {
+    GLsizei length = 0;
+    glGetActiveUniformBlockName(program, (GLuint)i, (GLsizei)name.size(),
+                                &length, name.data());
+    if (length == 0 ||
+        glGetUniformBlockIndex(program, name.data()) != (GLuint)i)
+      return false;
+  }
+  return true;
+}
+
+// Waits for a submitted program and reports errors. Errors are printed and
+// the program is kept anyway, like the labs always did. Does nothing for
+// programs that are already finished or came from the cache.
+inline void finishProgram(GLuint program) {
+  std::vector<PendingProgram> &pending = shaderCompiler().pending;
+  for (size_t i = 0; i < pending.size(); i++) {
+    if (pending[i].program != program)
+      continue;
+
+    PendingProgram &entry = pending[i];
+    if (entry.spirv) {
+      GLint linked = GL_FALSE;
+      glGetProgramiv(program, GL_LINK_STATUS, &linked);
+      if (linked && programNamesResolve(program)) {
+        spirvShaders().programs++;
+      } else {
+        // relink the same program object from the GLSL strings
+        spirvShaders().fallbacks++;
+        glDetachShader(program, entry.vertexShader);
+        glDetachShader(program, entry.fragmentShader);
+        glDeleteShader(entry.vertexShader);
+        glDeleteShader(entry.fragmentShader);
+        entry.vertexShader =
+            compileShader(GL_VERTEX_SHADER, entry.vertexSource.c_str());
+        entry.fragmentShader =
+            compileShader(GL_FRAGMENT_SHADER, entry.fragmentSource.c_str());
+        glAttachShader(program, entry.vertexShader);
+        glAttachShader(program, entry.fragmentShader);
+        glLinkProgram(program);
+      }
+    }
+
+    GLint status;
+    glGetShaderiv(entry.vertexShader, GL_COMPILE_STATUS, &status);
+    if (!status)
+      std::cout << "Error (" << entry.name
+                << ", vertex shader): " << shaderInfoLog(entry.vertexShader)
+                << std::endl;
+    glGetShaderiv(entry.fragmentShader, GL_COMPILE_STATUS, &status);
+    if (!status)
+      std::cout << "Error (" << entry.name << ", fragment shader): "
+                << shaderInfoLog(entry.fragmentShader) << std::endl;
+
+    GLint linked;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked)
+      std::cout << "Error (" << entry.name << "): " << programInfoLog(program)
+                << std::endl;
+
+    glDetachShader(program, entry.vertexShader);
+    glDetachShader(program, entry.fragmentShader);
+    glDeleteShader(entry.vertexShader);
+    glDeleteShader(entry.fragmentShader);
+
+    if (linked && shaderCache().enabled)
+      storeCachedProgram(entry.cachePath, program);
+    pending.erase(pending.begin() + i);
+    return;
+  }
+}
+
+inline GLuint createProgram(const GLchar *vertexSource,
+                            const GLchar *fragmentSource,
+                            const char *name = "Shader program") {
+  GLuint program = submitProgram(vertexSource, fragmentSource, name);
+  finishProgram(program);
+  return program;
+}
+
+// Active uniforms of a linked program, read once with glGetActiveUniform.
+// Locations are resolved here, so the render loop never looks up names.
+struct UniformInfo {
+  std::string name;
+  GLint location;
+  GLenum type;
+  GLint size; // array length, 1 for non-arrays
+};
+
+struct UniformTable {
+  std::string program; // name for messages
+  std::vector<UniformInfo> uniforms;
+};
+
+// call after finishProgram
+inline UniformTable reflectUniforms(GLuint program,
+                                    const char *name = "Shader program") {
+  UniformTable table;
+  table.program = name;
+
+  GLint count = 0, maxLength = 0;
+  glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+  glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+  std::vector<GLchar> buffer(maxLength > 0 ? maxLength : 1);
+  for (GLint i = 0; i < count; i++) {
+    UniformInfo uniform;
+    GLsizei length = 0;
+    glGetActiveUniform(program, (GLuint)i, (GLsizei)buffer.size(), &length,
+                       &uniform.size, &uniform.type, buffer.data());
+    uniform.name.assign(buffer.data(), length);
+    // arrays are reported as "name[0]"
+    if (uniform.name.size() > 3 &&
+        uniform.name.compare(uniform.name.size() - 3, 3, "[0]") == 0)
+      uniform.name.erase(uniform.name.size() - 3);
+    uniform.location = glGetUniformLocation(program, uniform.name.c_str());
+    // uniforms in blocks have no location
+    if (uniform.location >= 0)
+      table.uniforms.push_back(uniform);
+  }
+  return table;
+}
+
+// Location of an active uniform of the given GL type (GL_FLOAT_MAT4, ...).
+// Names the shader does not declare (or the compiler optimized out) and
+// type mismatches are reported, so typos show up at startup. -1 is ignored
+// by glUniform*, like a failed glGetUniformLocation.
+inline GLint uniformLocation(const UniformTable &table, const char *name,
+                             GLenum type) {
+  for (const UniformInfo &uniform : table.uniforms) {
+    if (uniform.name != name)
+      continue;
+    if (uniform.type != type)
+      std::printf("Uniform %s in %s has type 0x%04X, expected 0x%04X\n", name,
+                  table.program.c_str(), uniform.type, type);
+    return uniform.location;
+  }
+  std::printf("Uniform %s is not active in %s\n", name,
+              table.program.c_str());
+  return -1;
+}
+
+// Permutations of one vertex + fragment source pair. Bit i of a feature mask
+// adds "#define features[i]" after the #version line, so the preprocessor
+// strips every disabled branch and its uniforms. Variants are compiled the
+// first time they are asked for and kept (and go through the binary cache
+// like any other program).
+//
+// replaceShaderSources() rebuilds every variant from new sources. The old
+// program stays in use until the new one has linked; a failed link keeps it
+// for good. generation changes whenever the program is replaced, so callers
+// know to look their uniform locations up again.
+struct ShaderVariant {
+  unsigned features;
+  GLuint program;
+  bool finished;
+  UniformTable uniforms; // filled once finished
+  GLuint pending;        // rebuild from new sources, 0 if none
+  unsigned generation;
+};
+
+struct ShaderVariants {
+  std::string name;
+  std::string vertexSource;
+  std::string fragmentSource;
+  std::vector<const char *> features;
+  std::vector<ShaderVariant> variants;
+};
+
+inline ShaderVariants shaderVariants(const std::string &vertexSource,
+                                     const std::string &fragmentSource,
+                                     std::vector<const char *> features = {},
+                                     const char *name = "Shader program") {
+  ShaderVariants set;
+  set.name = name;
+  set.vertexSource = vertexSource;
+  set.fragmentSource = fragmentSource;
+  set.features = features;
+  return set;
+}
+
+inline std::string withFeatureDefines(const std::string &source,
+                                      const std::vector<const char *> &features,
+                                      unsigned mask) {
+  std::string text = source;
+  size_t line = text.compare(0, 8, "#version") == 0 ? text.find('\n') + 1 : 0;
+  std::string defines;
+  for (size_t i = 0; i < features.size(); i++)
+    if (mask & (1u << i))
+      defines += std::string("#define ") + features[i] + " 1\n";
+  return text.insert(line, defines);
+}
+
+inline GLuint submitVariantProgram(const ShaderVariants &set,
+                                   unsigned features, const char *name) {
+  std::string vertex =
+      withFeatureDefines(set.vertexSource, set.features, features);
+  std::string fragment =
+      withFeatureDefines(set.fragmentSource, set.features, features);
+  return submitProgram(vertex.c_str(), fragment.c_str(), name);
+}
+
+// starts compiling a variant without waiting for it
+inline ShaderVariant &submitShaderVariant(ShaderVariants &set,
+                                          unsigned features) {
+  for (ShaderVariant &variant : set.variants)
+    if (variant.features == features)
+      return variant;
+
+  std::string name = set.name;
+  for (size_t i = 0; i < set.features.size(); i++)
+    if (features & (1u << i))
+      name += std::string(" +") + set.features[i];
+
+  ShaderVariant variant;
+  variant.features = features;
+  variant.program = submitVariantProgram(set, features, name.c_str());
+  variant.finished = false;
+  variant.uniforms.program = name;
+  variant.pending = 0;
+  variant.generation = 0;
+  set.variants.push_back(variant);
+  return set.variants.back();
+}
+
+// swaps in a rebuilt program once it has linked; without parallel compile
+// there is no way to ask, so the link is waited for
+inline void swapRebuiltVariant(ShaderVariant &variant) {
+  if (shaderCompiler().parallel && !programCompleted(variant.pending))
+    return;
+
+  // a copy: reflecting the new program replaces the string it came from
+  std::string name = variant.uniforms.program;
+  finishProgram(variant.pending);
+  GLint linked = GL_FALSE;
+  glGetProgramiv(variant.pending, GL_LINK_STATUS, &linked);
+  if (!linked) {
+    glDeleteProgram(variant.pending);
+    variant.pending = 0;
+    std::cout << name << ": keeping the previous program" << std::endl;
+    return;
+  }
+
+  glDeleteProgram(variant.program);
+  variant.program = variant.pending;
+  variant.pending = 0;
+  variant.uniforms = reflectUniforms(variant.program, name.c_str());
+  variant.generation++;
+  std::cout << name << ": reloaded" << std::endl;
+}
+
+// the variant, linked and reflected; compiles it on first use
+inline const ShaderVariant &shaderVariant(ShaderVariants &set,
+                                          unsigned features) {
+  ShaderVariant &variant = submitShaderVariant(set, features);
+  if (!variant.finished) {
+    finishProgram(variant.program);
+    variant.uniforms =
+        reflectUniforms(variant.program, variant.uniforms.program.c_str());
+    variant.finished = true;
+  }
+  if (variant.pending != 0)
+    swapRebuiltVariant(variant);
+  return variant;
+}
+
+// submits every variant again from new sources; unchanged text does nothing
+inline void replaceShaderSources(ShaderVariants &set,
+                                 const std::string &vertexSource,
+                                 const std::string &fragmentSource) {
+  if (vertexSource == set.vertexSource &&
+      fragmentSource == set.fragmentSource)
+    return;
+
+  set.vertexSource = vertexSource;
+  set.fragmentSource = fragmentSource;
+  for (ShaderVariant &variant : set.variants) {
+    const char *name = variant.uniforms.program.c_str();
+    if (!variant.finished) {
+      // never used yet, nothing to keep
+      finishProgram(variant.program);
+      glDeleteProgram(variant.program);
+      variant.program = submitVariantProgram(set, variant.features, name);
+      continue;
+    }
+    if (variant.pending != 0) {
+      finishProgram(variant.pending);
+      glDeleteProgram(variant.pending);
+    }
+    variant.pending = submitVariantProgram(set, variant.features, name);
+  }
+}
+
+inline void deleteShaderVariants(ShaderVariants &set) {
+  for (ShaderVariant &variant : set.variants) {
+    finishProgram(variant.program);
+    glDeleteProgram(variant.program);
+    if (variant.pending != 0) {
+      finishProgram(variant.pending);
+      glDeleteProgram(variant.pending);
+    }
+  }
+  set.variants.clear();
+}
+
+inline void printShaderCache() {
+  const ShaderCacheState &cache = shaderCache();
+  if (cache.enabled)
+    std::printf("shader cache: %ld hits, %ld misses\n", cache.hits,
+                cache.misses);
+  const SpirvState &spirv = spirvShaders();
+  if (spirv.enabled)
+    std::printf("SPIR-V: %ld programs, %ld fell back to GLSL\n",
+                spirv.programs, spirv.fallbacks);
+}
+
+#endif
@@ -0,0 +1,6 @@
+#version 330 core
+out vec4 fragmentColor;
+void main()
+{
+ fragmentColor = vec4(0.30f, 0.50f, 1.0f, 1.0f);
+}
@@ -0,0 +1,8 @@
+#version 330 core
+layout(location = 0) in vec3 position;
+out vec3 vertexColor;
+void main()
+{
+ gl_Position = vec4(position.x, position.y, position.z, 1.0);
+ vertexColor = vec3(0.30f, 0.50f, 1.0f);
+}
@@ -1,167 +1,154 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
-#define _USE_MATH_DEFINES
-
 #include <iostream>
-#include <math.h>
-
-const GLchar *vertexShaderSource =
-    "#version 330 core\n"
-    "layout(location = 0) in vec3 position;\n"
-    "out vec3 vertexColor;\n"
-    "void main()\n"
-    "{\n"
-    " gl_Position = vec4(position.x, position.y, position.z, 1.0);\n"
-    " vertexColor = vec3(0.30f, 0.50f, 1.0f);\n"
-    "}\0";
-
-const GLchar *fragmentShaderSource =
-    "#version 330 core\n"
-    "out vec4 fragmentColor;\n"
-    "void main()\n"
-    "{\n"
-    " fragmentColor = vec4(0.30f, 0.50f, 1.0f, 1.0f);\n"
-    "}\0";
-
-GLfloat *vertices;
-GLuint *indices;
-
-int main() {
-  // inicjalizacja GLFW
-  glfwInit();
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-  // Tworzenie okna
+
+#include "bench.h"
+#include "headless.h"
+#include "polygon.h"
+#include "shader.h"
+#include "shader_files.h"
+
+int main(int argc, char **argv) {
+  StartupProfile startup;
+  RunOptions options = parseRunOptions(argc, argv);
+
   const unsigned int window_width = 800;
   const unsigned int window_height = 800;
-  GLFWwindow *window = glfwCreateWindow(window_width, window_height,
-                                        "grafika komputerowa", NULL, NULL);
-  if (window == NULL) {
-    std::cout << "Failed to create GLFW window" << std::endl;
-    glfwTerminate();
-    return -1;
+  GLFWwindow *window = NULL;
+  HeadlessContext headless;
+
+  if (options.headless) {
+    if (!createHeadlessContext(headless, window_width, window_height,
+                               options.debugOutput))
+      return -1;
+    markStartupPhase(startup, "egl context");
+  } else {
+    // inicjalizacja GLFW
+    glfwInit();
+    markStartupPhase(startup, "glfwInit");
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT,
+                   options.debugOutput ? GLFW_TRUE : GLFW_FALSE);
+
+    // Tworzenie okna
+    window = glfwCreateWindow(window_width, window_height,
+                              "grafika komputerowa", NULL, NULL);
+    if (window == NULL) {
+      std::cout << "Failed to create GLFW window" << std::endl;
+      glfwTerminate();
+      return -1;
+    }
+    glfwMakeContextCurrent(window);
+    markStartupPhase(startup, "window");
   }
-  glfwMakeContextCurrent(window);
 
   // inicjalizacja GLAD
-  if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+  GLADloadproc loader = options.headless ? (GLADloadproc)headlessGetProcAddress
+                                         : (GLADloadproc)glfwGetProcAddress;
+  if (!gladLoadGLLoader(loader)) {
     std::cout << "Failed to initialize GLAD" << std::endl;
     return -1;
   }
 
-  GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-  glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-  glCompileShader(vertexShader);
-
-  GLint status;
-  GLchar error_message[512];
-  glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &status);
-  if (!status) {
-    glGetShaderInfoLog(vertexShader, 512, NULL, error_message);
-    std::cout << "Error (Vertex shader): " << error_message << std::endl;
-  }
-
-  GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-  glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-  glCompileShader(fragmentShader);
-  glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &status);
-  if (!status) {
-    glGetShaderInfoLog(fragmentShader, 512, NULL, error_message);
-    std::cout << "Error (Fragment shader): " << error_message << std::endl;
-  }
-
-  GLuint shaderProgram = glCreateProgram();
-  glAttachShader(shaderProgram, vertexShader);
-  glAttachShader(shaderProgram, fragmentShader);
-  glLinkProgram(shaderProgram);
-
-  glGetProgramiv(shaderProgram, GL_LINK_STATUS, &status);
-  if (!status) {
-    glGetProgramInfoLog(shaderProgram, 512, NULL, error_message);
-    std::cout << "Error (Shader program): " << error_message << std::endl;
+  if (options.glCounters)
+    installGlCounters();
+  if (options.debugOutput)
+    enableDebugOutput(loader);
+  initParallelShaderCompile(loader);
+  if (options.shaderCache != NULL)
+    initShaderCache(options.shaderCache, loader);
+  if (options.spirv != NULL || options.dumpShaders != NULL)
+    initSpirvShaders(options.spirv, options.dumpShaders, loader);
+  if (options.hotReload)
+    initShaderHotReload();
+
+  if (options.headless &&
+      !createHeadlessFramebuffer(headless, window_width, window_height))
+    return -1;
+  if (options.overdraw)
+    enableOverdraw();
+  markStartupPhase(startup, "glad");
+
+  ShaderVariants polygonShader = shaderVariants(
+      loadShaderFile("polygon.vert"), loadShaderFile("polygon.frag"));
+  watchShaderVariants(polygonShader, "polygon.vert", "polygon.frag");
+  submitShaderVariant(polygonShader, 0);
+  markStartupPhase(startup, "shaders");
+
+  long long n = options.scale;
+  if (n < 8 && options.headless) {
+    std::cout << "--headless needs --scale with at least 8 vertices"
+              << std::endl;
+    return -1;
   }
-
-  glDetachShader(shaderProgram, vertexShader);
-  glDetachShader(shaderProgram, fragmentShader);
-
-  int n = 0;
   while (n < 8) {
     std::cout << "Podaj ilosc wierzcholkow wielokata: ";
-    std::cin >> n;
+    if (!(std::cin >> n)) {
+      std::cout << "Failed to read vertex count" << std::endl;
+      return -1;
+    }
     std::cout << "\n";
   }
 
-  vertices = new GLfloat[(n + 1) * 3];
-  vertices[0] = 0.0f;
-  vertices[1] = 0.0f;
-  vertices[2] = 0.0f;
-
-  for (int i = 0; i <= n; i++) {
-    vertices[(i + 1) * 3] = 0.5f * std::cos(2 * M_PI * i / n);
-    vertices[(i + 1) * 3 + 1] = 0.5f * std::sin(2 * M_PI * i / n);
-    vertices[(i + 1) * 3 + 2] = 0.0f;
-  }
-
-  indices = new GLuint[(n + 1) * 3];
-  for (int i = 1; i <= n; i++) {
-    indices[i * 3 + 0] = 0;
-    indices[i * 3 + 1] = i;
-    indices[i * 3 + 2] = i + 1;
-  }
-  indices[n * 3] = 0;
-  indices[n * 3 + 1] = n;
-  indices[n * 3 + 2] = 1;
-
-  GLuint VAO;
-  glGenVertexArrays(1, &VAO);
-  glBindVertexArray(VAO);
-
-  GLuint VBO;
-  glGenBuffers(1, &VBO);
-  glBindBuffer(GL_ARRAY_BUFFER, VBO);
-  glBufferData(GL_ARRAY_BUFFER, (n + 1) * 3 * sizeof(GLfloat), vertices,
-               GL_STATIC_DRAW);
-
-  delete[] vertices;
-  
-  GLuint EBO;
-  glGenBuffers(1, &EBO);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, (n + 1) * 3 * sizeof(GLuint), indices,
-               GL_STATIC_DRAW);
+  PolygonMesh polygon;
+  if (!createPolygonMesh(polygon, (uint64_t)n,
+                         options.strip ? POLYGON_STRIP : POLYGON_FAN,
+                         options.optimizeMeshes))
+    return -1;
 
-  delete[] indices;
+  glViewport(0, 0, (GLuint)window_width, (GLuint)window_height);
 
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat),
-                        (void *)0);
-  glEnableVertexAttribArray(0);
+  FrameStats frameStats;
+  initFrameStats(frameStats);
 
-  glBindVertexArray(0);
+  GpuProfiler gpuProfiler;
+  gpuProfiler.enabled = options.gpuProfile || options.bench != NULL;
 
-  glViewport(0, 0, (GLuint)window_width, (GLuint)window_height);
+  shaderVariant(polygonShader, 0);
+  markStartupPhase(startup, "scene");
+  double cpuStart = processCpuTime();
+  double previousTime = runTime(window);
 
   // pętla zdarzeń
-  while (!glfwWindowShouldClose(window)) {
+  long frame = 0;
+  while (keepRunning(window, options, frame)) {
+    pollShaderFiles();
+    beginGpuFrame(gpuProfiler);
+    pushGpuScope(gpuProfiler, "frame");
+
     glClearColor(0.18f, 0.2f, 0.22f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT);
 
-    glUseProgram(shaderProgram);
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, (n + 1) * 3, GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+    glUseProgram(shaderVariant(polygonShader, 0).program);
+    drawPolygonMesh(polygon);
+
+    popGpuScope(gpuProfiler);
+    endGpuFrame(gpuProfiler);
+    endGlCounterFrame();
 
-    glfwSwapBuffers(window);
-    glfwPollEvents();
+    presentFrame(window);
+    if (frame == 0)
+      markFirstFrame(startup);
+
+    double currentTime = runTime(window);
+    recordFrame(frameStats, currentTime - previousTime);
+    previousTime = currentTime;
+    frame++;
   }
 
-  glDeleteVertexArrays(1, &VAO);
-  glDeleteBuffers(1, &VBO);
-  glDeleteBuffers(1, &EBO);
-  glDeleteProgram(shaderProgram);
+  bool passed = reportRun(options, "l3", n, frameStats, gpuProfiler, startup,
+                          processCpuTime() - cpuStart);
+  destroyGpuProfiler(gpuProfiler);
+
+  deletePolygonMesh(polygon);
+  deleteShaderVariants(polygonShader);
 
-  glfwTerminate();
-  return 0;
+  if (options.headless)
+    destroyHeadlessContext(headless);
+  else
+    glfwTerminate();
+  return passed ? 0 : 1;
 }
\ No newline at end of file
@@ -0,0 +1,245 @@
+#ifndef POLYGON_H
+#define POLYGON_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "index_buffer.h"
+#include "mesh_optimize.h"
+
+// Regular n-gon of radius 0.5 for stress scenes with up to a few billion
+// vertices. Vertices (xy, the center first) and indices are written by
+// worker threads straight into mapped GL buffers, so nothing is staged in
+// client memory. Sizes are 64-bit throughout; the only limits are 32-bit
+// indices (n + 1 vertices) and GLsizei per draw, which drawPolygonMesh works
+// around by splitting the draw. Indices are as narrow as n allows (see
+// index_buffer.h); every triangle shares the center, so splitting into
+// 16-bit chunks does not apply.
+//
+// The fan is n triangles around the center (3n indices); the strip zig-zags
+// across the rim (n indices, n - 2 triangles, center unused). With optimize
+// the fan goes through optimizeMesh first, which needs it in client memory.
+enum PolygonTopology { POLYGON_FAN, POLYGON_STRIP };
+
+struct PolygonMesh {
+  GLuint vertexArray = 0;
+  GLuint vertexBuffer = 0;
+  GLuint indexBuffer = 0;
+  GLenum mode = GL_TRIANGLES;
+  GLenum indexType = GL_UNSIGNED_INT;
+  uint64_t vertexCount = 0;
+  uint64_t indexCount = 0;
+};
+
+const uint64_t polygonMaxSides = UINT32_MAX - 1; // n + 1 indexable vertices
+const uint64_t polygonBlock = 1024; // vertices per inner loop
+
+// Positions of rim vertices [first, first + count) into xy. sin and cos come
+// from short polynomials on [-pi/4, pi/4] after an exact quarter-turn
+// reduction, written branch-free so the compiler vectorizes the loop; the
+// angle itself is kept in double since float cannot tell apart the
+// neighbouring vertices of a large n.
+inline void polygonRim(GLfloat *xy, uint64_t first, uint64_t count,
+                       uint64_t n) {
+  const double quarterTurns = 4.0 / (double)n; // per vertex
+  const float halfPi = 1.57079632679489662f;
+  // whole blocks only: a constant trip count is what -O2 vectorizes
+  GLfloat block[2 * polygonBlock];
+  for (uint64_t start = 0; start < count; start += polygonBlock) {
+    double base = (double)(first + start) * quarterTurns;
+    for (int k = 0; k < (int)polygonBlock; k++) {
+      double t = base + (double)k * quarterTurns; // in [0, 4)
+      int quadrant = (int)(t + 0.5);
+      float x = (float)(t - quadrant) * halfPi;
+      float x2 = x * x;
+      float s = x * (1.0f + x2 * (-1.0f / 6 + x2 * (1.0f / 120 +
+                x2 * (-1.0f / 5040 + x2 * (1.0f / 362880)))));
+      float c = 1.0f + x2 * (-0.5f + x2 * (1.0f / 24 +
+                x2 * (-1.0f / 720 + x2 * (1.0f / 40320))));
+      // rotate by quadrant quarter turns
+      bool swap = (quadrant & 1) != 0;
+      float cosine = swap ? s : c;
+      float sine = swap ? c : s;
+      cosine *= ((quadrant + 1) & 2) ? -0.5f : 0.5f;
+      sine *= (quadrant & 2) ? -0.5f : 0.5f;
+      block[2 * k] = cosine;
+      block[2 * k + 1] = sine;
+    }
+    uint64_t used = std::min(polygonBlock, count - start);
+    std::memcpy(xy + 2 * start, block, used * 2 * sizeof(GLfloat));
+  }
+}
+
+// indices of rim vertices [first, first + count)
+template <typename T>
+inline void polygonIndices(T *indices, PolygonTopology topology,
+                           uint64_t first, uint64_t count, uint64_t n) {
+  if (topology == POLYGON_FAN) {
+    for (uint64_t r = first; r < first + count; r++) {
+      indices[3 * r] = 0;
+      indices[3 * r + 1] = (T)(r + 1);
+      indices[3 * r + 2] = (T)(r + 1 == n ? 1 : r + 2);
+    }
+    return;
+  }
+  // 0, 1, n-1, 2, n-2, ... on the rim; +1 skips the center
+  for (uint64_t k = first; k < first + count; k++) {
+    uint64_t j = (k + 1) / 2;
+    indices[k] = (T)((k & 1) ? j + 1 : (j == 0 ? 1 : n - j + 1));
+  }
+}
+
+inline void polygonIndices(void *indices, GLenum type,
+                           PolygonTopology topology, uint64_t first,
+                           uint64_t count, uint64_t n) {
+  if (type == GL_UNSIGNED_BYTE)
+    polygonIndices((GLubyte *)indices, topology, first, count, n);
+  else if (type == GL_UNSIGNED_SHORT)
+    polygonIndices((GLushort *)indices, topology, first, count, n);
+  else
+    polygonIndices((GLuint *)indices, topology, first, count, n);
+}
+
+// threads == 0 uses every hardware thread
+inline bool createPolygonMesh(PolygonMesh &mesh, uint64_t n,
+                              PolygonTopology topology, bool optimize = false,
+                              unsigned threads = 0) {
+  if (n < 3 || n > polygonMaxSides) {
+    std::cout << "Polygon needs 3 to " << polygonMaxSides << " vertices, got "
+              << n << std::endl;
+    return false;
+  }
+
+  mesh.mode = topology == POLYGON_FAN ? GL_TRIANGLES : GL_TRIANGLE_STRIP;
+  mesh.vertexCount = n + 1;
+  mesh.indexCount = topology == POLYGON_FAN ? 3 * n : n;
+  mesh.indexType = indexTypeFor((GLuint)n);
+  uint64_t vertexBytes = mesh.vertexCount * 2 * sizeof(GLfloat);
+  uint64_t indexBytes = mesh.indexCount * indexSize(mesh.indexType);
+  if (vertexBytes > (uint64_t)PTRDIFF_MAX ||
+      indexBytes > (uint64_t)PTRDIFF_MAX) {
+    std::cout << "Polygon with " << n << " vertices does not fit in memory"
+              << std::endl;
+    return false;
+  }
+
+  glGenVertexArrays(1, &mesh.vertexArray);
+  glBindVertexArray(mesh.vertexArray);
+  glGenBuffers(1, &mesh.vertexBuffer);
+  glBindBuffer(GL_ARRAY_BUFFER, mesh.vertexBuffer);
+  glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)vertexBytes, NULL, GL_STATIC_DRAW);
+  glGenBuffers(1, &mesh.indexBuffer);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.indexBuffer);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)indexBytes, NULL,
+               GL_STATIC_DRAW);
+  // z is left to the attribute default of 0
+  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat),
+                        (void *)0);
+  glEnableVertexAttribArray(0);
+
+  GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT;
+  GLfloat *vertices = (GLfloat *)glMapBufferRange(
+      GL_ARRAY_BUFFER, 0, (GLsizeiptr)vertexBytes, access);
+  void *indices = glMapBufferRange(
+      GL_ELEMENT_ARRAY_BUFFER, 0, (GLsizeiptr)indexBytes, access);
+  if (vertices == NULL || indices == NULL) {
+    std::cout << "Failed to map the polygon buffers (" << vertexBytes +
+                 indexBytes << " bytes)" << std::endl;
+    if (vertices != NULL)
+      glUnmapBuffer(GL_ARRAY_BUFFER);
+    if (indices != NULL)
+      glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER);
+    glBindVertexArray(0);
+    return false;
+  }
+
+  // small polygons are not worth starting threads for
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  threads = (unsigned)std::min<uint64_t>(threads, n / 65536 + 1);
+
+  // the generated mesh goes to the mapped buffers, or through these first
+  std::vector<GLfloat> optimizedVertices;
+  std::vector<GLuint> optimizedIndices;
+  optimize = optimize && topology == POLYGON_FAN;
+  if (optimize) {
+    optimizedVertices.resize(2 * mesh.vertexCount);
+    optimizedIndices.resize(mesh.indexCount);
+  }
+  GLfloat *vertexTarget = optimize ? optimizedVertices.data() : vertices;
+  void *indexTarget = optimize ? (void *)optimizedIndices.data() : indices;
+  GLenum indexTargetType = optimize ? GL_UNSIGNED_INT : mesh.indexType;
+
+  vertexTarget[0] = 0.0f;
+  vertexTarget[1] = 0.0f;
+  std::vector<std::thread> workers;
+  for (unsigned t = 0; t < threads; t++) {
+    uint64_t first = n * t / threads;
+    uint64_t count = n * (t + 1) / threads - first;
+    workers.emplace_back([=] {
+      polygonRim(vertexTarget + 2 * (first + 1), first, count, n);
+      polygonIndices(indexTarget, indexTargetType, topology, first, count, n);
+    });
+  }
+  for (std::thread &worker : workers)
+    worker.join();
+
+  if (optimize) {
+    const GLfloat viewDirection[3] = {0.0f, 0.0f, -1.0f};
+    optimizeMesh(optimizedVertices, 2, optimizedIndices, viewDirection,
+                 "polygon");
+    std::memcpy(vertices, optimizedVertices.data(), (size_t)vertexBytes);
+    if (mesh.indexType == GL_UNSIGNED_INT)
+      std::memcpy(indices, optimizedIndices.data(), (size_t)indexBytes);
+    else
+      for (uint64_t i = 0; i < mesh.indexCount; i++)
+        if (mesh.indexType == GL_UNSIGNED_BYTE)
+          ((GLubyte *)indices)[i] = (GLubyte)optimizedIndices[i];
+        else
+          ((GLushort *)indices)[i] = (GLushort)optimizedIndices[i];
+  }
+
+  bool ok = glUnmapBuffer(GL_ARRAY_BUFFER) == GL_TRUE;
+  ok = glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER) == GL_TRUE && ok;
+  glBindVertexArray(0);
+  if (!ok)
+    std::cout << "Polygon buffers were lost while mapped" << std::endl;
+
+  IndexBufferStats &stats = indexBufferStats();
+  stats.buffers++;
+  stats.bytes += (double)indexBytes;
+  stats.bytesAsUint += (double)(mesh.indexCount * sizeof(GLuint));
+  return ok;
+}
+
+// one glDrawElements per at most 2^30 indices, since the count is a GLsizei
+inline void drawPolygonMesh(const PolygonMesh &mesh) {
+  // a multiple of 3 for triangles; strips restart two indices back, at an
+  // even offset so the winding does not flip
+  const uint64_t limit = mesh.mode == GL_TRIANGLES ? 3u << 28 : 1u << 30;
+  const uint64_t overlap = mesh.mode == GL_TRIANGLES ? 0 : 2;
+  glBindVertexArray(mesh.vertexArray);
+  for (uint64_t first = 0;; first += limit - overlap) {
+    uint64_t count = std::min(limit, mesh.indexCount - first);
+    glDrawElements(mesh.mode, (GLsizei)count, mesh.indexType,
+                   (void *)(uintptr_t)(first * indexSize(mesh.indexType)));
+    if (first + count >= mesh.indexCount)
+      break;
+  }
+  glBindVertexArray(0);
+}
+
+inline void deletePolygonMesh(PolygonMesh &mesh) {
+  glDeleteVertexArrays(1, &mesh.vertexArray);
+  glDeleteBuffers(1, &mesh.vertexBuffer);
+  glDeleteBuffers(1, &mesh.indexBuffer);
+  mesh = PolygonMesh();
+}
+
+#endif
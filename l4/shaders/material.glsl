@@ -0,0 +1,6 @@
+// one material slot of the parameter block (Material in main.cpp)
+layout(std140) uniform Material
+{
+    vec3 shapeColor;
+    float scrollOffset;
+};
@@ -0,0 +1,7 @@
+#version 330 core
+out vec4 fragmentColor;
+#include "material.glsl"
+void main()
+{
+ fragmentColor = vec4(shapeColor, 1.0f);
+}
@@ -0,0 +1,9 @@
+#version 330 core
+layout(location = 0) in vec3 position;
+#include "material.glsl"
+out vec3 vertexColor;
+void main()
+{
+ gl_Position = vec4(position.x, position.y+scrollOffset, position.z, 1.0);
+ vertexColor = vec3(0.30f, 0.50f, 1.0f);
+}
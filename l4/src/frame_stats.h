@@ -0,0 +1,144 @@
+#ifndef FRAME_STATS_H
+#define FRAME_STATS_H
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+// Frame times of the last `capacity` frames in a fixed ring buffer. Nothing is
+// allocated after initFrameStats, so recording and the mean / last frame
+// queries are safe inside the render loop. summarizeFrames copies and sorts
+// the whole buffer and is meant for the end of the run.
+struct FrameStats {
+  std::vector<double> times; // seconds
+  size_t next = 0;
+  size_t total = 0;
+};
+
+struct FrameSummary {
+  size_t frames = 0;
+  double min = 0.0, mean = 0.0, p50 = 0.0, p95 = 0.0, p99 = 0.0, max = 0.0;
+};
+
+inline void initFrameStats(FrameStats &stats, size_t capacity = 1 << 16) {
+  stats.times.assign(capacity, 0.0);
+  stats.next = 0;
+  stats.total = 0;
+}
+
+inline void recordFrame(FrameStats &stats, double seconds) {
+  stats.times[stats.next] = seconds;
+  stats.next = (stats.next + 1) % stats.times.size();
+  stats.total++;
+}
+
+inline size_t recordedFrames(const FrameStats &stats) {
+  return std::min(stats.total, stats.times.size());
+}
+
+inline double lastFrameTime(const FrameStats &stats) {
+  if (stats.total == 0)
+    return 0.0;
+  return stats.times[(stats.next + stats.times.size() - 1) %
+                     stats.times.size()];
+}
+
+inline double meanFrameTime(const FrameStats &stats) {
+  size_t count = recordedFrames(stats);
+  double sum = 0.0;
+  for (size_t i = 0; i < count; i++)
+    sum += stats.times[i];
+  return count ? sum / count : 0.0;
+}
+
+// oldest first
+inline std::vector<double> frameTimes(const FrameStats &stats) {
+  size_t count = recordedFrames(stats);
+  size_t first = stats.total > stats.times.size() ? stats.next : 0;
+  std::vector<double> ordered(count);
+  for (size_t i = 0; i < count; i++)
+    ordered[i] = stats.times[(first + i) % stats.times.size()];
+  return ordered;
+}
+
+inline FrameSummary summarizeFrames(const FrameStats &stats) {
+  FrameSummary summary;
+  std::vector<double> sorted = frameTimes(stats);
+  if (sorted.empty())
+    return summary;
+
+  std::sort(sorted.begin(), sorted.end());
+  double sum = 0.0;
+  for (double time : sorted)
+    sum += time;
+
+  // nearest-rank percentile
+  auto percentile = [&sorted](double p) {
+    size_t rank = (size_t)(p * sorted.size() + 0.999999);
+    return sorted[std::min(std::max(rank, (size_t)1), sorted.size()) - 1];
+  };
+
+  summary.frames = sorted.size();
+  summary.min = sorted.front();
+  summary.mean = sum / sorted.size();
+  summary.p50 = percentile(0.50);
+  summary.p95 = percentile(0.95);
+  summary.p99 = percentile(0.99);
+  summary.max = sorted.back();
+  return summary;
+}
+
+inline void printFrameSummary(const FrameSummary &summary) {
+  std::printf("frames: %zu  min %.3f  mean %.3f  p50 %.3f  p95 %.3f  "
+              "p99 %.3f  max %.3f ms\n",
+              summary.frames, summary.min * 1000.0, summary.mean * 1000.0,
+              summary.p50 * 1000.0, summary.p95 * 1000.0,
+              summary.p99 * 1000.0, summary.max * 1000.0);
+}
+
+inline bool writeFrameStatsCsv(const FrameStats &stats, const char *path) {
+  FILE *file = std::fopen(path, "w");
+  if (file == NULL) {
+    std::cout << "Failed to write " << path << std::endl;
+    return false;
+  }
+
+  std::vector<double> times = frameTimes(stats);
+  size_t firstFrame = stats.total - times.size();
+  std::fprintf(file, "frame,time_ms\n");
+  for (size_t i = 0; i < times.size(); i++)
+    std::fprintf(file, "%zu,%.6f\n", firstFrame + i, times[i] * 1000.0);
+
+  std::fclose(file);
+  return true;
+}
+
+inline bool writeFrameStatsJson(const FrameStats &stats, const char *path) {
+  FILE *file = std::fopen(path, "w");
+  if (file == NULL) {
+    std::cout << "Failed to write " << path << std::endl;
+    return false;
+  }
+
+  FrameSummary summary = summarizeFrames(stats);
+  std::vector<double> times = frameTimes(stats);
+  std::fprintf(file,
+               "{\n  \"total_frames\": %zu,\n  \"frames\": %zu,\n"
+               "  \"min_ms\": %.6f,\n  \"mean_ms\": %.6f,\n"
+               "  \"p50_ms\": %.6f,\n  \"p95_ms\": %.6f,\n"
+               "  \"p99_ms\": %.6f,\n  \"max_ms\": %.6f,\n"
+               "  \"frame_times_ms\": [",
+               stats.total, summary.frames, summary.min * 1000.0,
+               summary.mean * 1000.0, summary.p50 * 1000.0,
+               summary.p95 * 1000.0, summary.p99 * 1000.0,
+               summary.max * 1000.0);
+  for (size_t i = 0; i < times.size(); i++)
+    std::fprintf(file, "%s%.6f", i == 0 ? "" : ", ", times[i] * 1000.0);
+  std::fprintf(file, "]\n}\n");
+
+  std::fclose(file);
+  return true;
+}
+
+#endif
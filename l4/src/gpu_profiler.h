@@ -0,0 +1,178 @@
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Nested GPU scopes measured with GL_TIMESTAMP query pairs (GL_TIME_ELAPSED
+// cannot nest). Queries are pooled per frame and the pools rotate over
+// gpuProfilerLatency frames: a frame's results are read back when its pool
+// comes round again, gpuProfilerLatency frames after they were issued, so
+// glGetQueryObject never waits on the GPU. If the frame is still not
+// finished by then, its results are dropped, not waited for.
+const int gpuProfilerLatency = 3;
+
+struct GpuScopeMarker {
+  const char *name;
+  int depth;
+  GLuint begin;
+  GLuint end;
+};
+
+struct GpuFrameQueries {
+  std::vector<GLuint> queries; // pool, reused every time the slot comes round
+  size_t used = 0;
+  std::vector<GpuScopeMarker> scopes;
+};
+
+struct GpuScopeStats {
+  std::string path;
+  int depth;
+  double total = 0.0; // seconds
+  double min = 0.0;
+  double max = 0.0;
+  long samples = 0;
+};
+
+struct GpuProfiler {
+  bool enabled = false;
+  long frame = 0;
+  long droppedFrames = 0;
+  GpuFrameQueries frames[gpuProfilerLatency];
+  std::vector<size_t> open; // indices into the current frame's scopes
+  std::vector<GpuScopeStats> stats;
+};
+
+inline GLuint takeGpuQuery(GpuFrameQueries &slot) {
+  if (slot.used == slot.queries.size()) {
+    GLuint query;
+    glGenQueries(1, &query);
+    slot.queries.push_back(query);
+  }
+  return slot.queries[slot.used++];
+}
+
+inline GpuScopeStats &gpuScopeStats(GpuProfiler &profiler,
+                                    const std::string &path, int depth) {
+  for (GpuScopeStats &entry : profiler.stats)
+    if (entry.path == path)
+      return entry;
+  GpuScopeStats entry;
+  entry.path = path;
+  entry.depth = depth;
+  profiler.stats.push_back(entry);
+  return profiler.stats.back();
+}
+
+inline void collectGpuFrame(GpuProfiler &profiler, GpuFrameQueries &slot) {
+  if (slot.scopes.empty())
+    return;
+
+  // timestamps complete in order, so the last one issued covers the frame
+  GLint available = 0;
+  glGetQueryObjectiv(slot.queries[slot.used - 1], GL_QUERY_RESULT_AVAILABLE,
+                     &available);
+  if (!available) {
+    profiler.droppedFrames++;
+    return;
+  }
+
+  std::vector<std::string> parents;
+  for (const GpuScopeMarker &scope : slot.scopes) {
+    if (scope.end == 0)
+      continue;
+
+    GLuint64 begin = 0, end = 0;
+    glGetQueryObjectui64v(scope.begin, GL_QUERY_RESULT, &begin);
+    glGetQueryObjectui64v(scope.end, GL_QUERY_RESULT, &end);
+
+    parents.resize(scope.depth);
+    std::string path =
+        parents.empty() ? scope.name : parents.back() + "/" + scope.name;
+    parents.push_back(path);
+
+    double seconds = (end - begin) * 1e-9;
+    GpuScopeStats &entry = gpuScopeStats(profiler, path, scope.depth);
+    entry.min = entry.samples == 0 ? seconds : std::min(entry.min, seconds);
+    entry.max = std::max(entry.max, seconds);
+    entry.total += seconds;
+    entry.samples++;
+  }
+}
+
+inline void beginGpuFrame(GpuProfiler &profiler) {
+  if (!profiler.enabled)
+    return;
+
+  GpuFrameQueries &slot = profiler.frames[profiler.frame % gpuProfilerLatency];
+  collectGpuFrame(profiler, slot);
+  slot.used = 0;
+  slot.scopes.clear();
+  profiler.open.clear();
+}
+
+inline void endGpuFrame(GpuProfiler &profiler) {
+  if (!profiler.enabled)
+    return;
+  profiler.frame++;
+}
+
+inline void pushGpuScope(GpuProfiler &profiler, const char *name) {
+  if (!profiler.enabled)
+    return;
+
+  GpuFrameQueries &slot = profiler.frames[profiler.frame % gpuProfilerLatency];
+  GpuScopeMarker scope = {name, (int)profiler.open.size(), takeGpuQuery(slot),
+                          0};
+  glQueryCounter(scope.begin, GL_TIMESTAMP);
+  profiler.open.push_back(slot.scopes.size());
+  slot.scopes.push_back(scope);
+}
+
+inline void popGpuScope(GpuProfiler &profiler) {
+  if (!profiler.enabled || profiler.open.empty())
+    return;
+
+  GpuFrameQueries &slot = profiler.frames[profiler.frame % gpuProfilerLatency];
+  GpuScopeMarker &scope = slot.scopes[profiler.open.back()];
+  scope.end = takeGpuQuery(slot);
+  glQueryCounter(scope.end, GL_TIMESTAMP);
+  profiler.open.pop_back();
+}
+
+// average GPU time of a top-level or nested scope ("frame/cube"), 0 if unseen
+inline double gpuScopeAverage(const GpuProfiler &profiler, const char *path) {
+  for (const GpuScopeStats &entry : profiler.stats)
+    if (entry.path == path)
+      return entry.total / entry.samples;
+  return 0.0;
+}
+
+inline void printGpuProfile(const GpuProfiler &profiler) {
+  if (!profiler.enabled)
+    return;
+
+  std::printf("GPU time per scope (%ld frames dropped):\n",
+              profiler.droppedFrames);
+  for (const GpuScopeStats &entry : profiler.stats) {
+    std::string name = entry.path.substr(entry.path.rfind('/') + 1);
+    std::printf("  %*s%-*s avg %.3f  min %.3f  max %.3f ms  (%ld)\n",
+                entry.depth * 2, "", 20 - entry.depth * 2, name.c_str(),
+                entry.total / entry.samples * 1000.0, entry.min * 1000.0,
+                entry.max * 1000.0, entry.samples);
+  }
+}
+
+inline void destroyGpuProfiler(GpuProfiler &profiler) {
+  for (GpuFrameQueries &slot : profiler.frames) {
+    if (!slot.queries.empty())
+      glDeleteQueries((GLsizei)slot.queries.size(), slot.queries.data());
+    slot.queries.clear();
+  }
+}
+
+#endif
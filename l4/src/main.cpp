@@ -1,28 +1,16 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+#include <cstddef>
 #include <iostream>
 #include <math.h>
 
-const GLchar *vertexShaderSource =
-    "#version 330 core\n"
-    "layout(location = 0) in vec3 position;\n"
-    "uniform float scrollOffset;\n"
-    "out vec3 vertexColor;\n"
-    "void main()\n"
-    "{\n"
-    " gl_Position = vec4(position.x, position.y+scrollOffset, position.z, 1.0);\n"
-    " vertexColor = vec3(0.30f, 0.50f, 1.0f);\n"
-    "}\0";
-
-const GLchar *fragmentShaderSource =
-    "#version 330 core\n"
-    "out vec4 fragmentColor;\n"
-    "uniform vec3 shapeColor;\n"
-    "void main()\n"
-    "{\n"
-    " fragmentColor = vec4(shapeColor, 1.0f);\n"
-    "}\0";
+#include "bench.h"
+#include "headless.h"
+#include "index_buffer.h"
+#include "parameter_block.h"
+#include "shader.h"
+#include "shader_files.h"
 
 float scrollOffset = 0.0f;
 
@@ -43,6 +31,14 @@ GLfloat colors[][3] = {
 
 int colorIndex = 0;
 
+// std140 layout of shaders/material.glsl; slot 0 is the scrolled shape, slot
+// 1 the shape colored with keys 1-3
+struct Material {
+  GLfloat shapeColor[3];
+  GLfloat scrollOffset;
+};
+const GLuint materialBinding = 0;
+
 void keyPressPooling(GLFWwindow* window){
     if (glfwGetKey(window, GLFW_KEY_1) == GLFW_PRESS) {
         colorIndex = 0;
@@ -55,67 +51,76 @@ void keyPressPooling(GLFWwindow* window){
     }
 }
 
-int main() {
-  // inicjalizacja GLFW
-  glfwInit();
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+int main(int argc, char **argv) {
+  StartupProfile startup;
+  RunOptions options = parseRunOptions(argc, argv);
 
-  // Tworzenie okna
   const unsigned int window_width = 1000;
   const unsigned int window_height = 1000;
-  GLFWwindow *window = glfwCreateWindow(window_width, window_height,
-                                        "grafika komputerowa", NULL, NULL);
-  if (window == NULL) {
-    std::cout << "Failed to create GLFW window" << std::endl;
-    glfwTerminate();
-    return -1;
-  }
+  GLFWwindow *window = NULL;
+  HeadlessContext headless;
+
+  if (options.headless) {
+    if (!createHeadlessContext(headless, window_width, window_height,
+                               options.debugOutput))
+      return -1;
+    markStartupPhase(startup, "egl context");
+  } else {
+    // inicjalizacja GLFW
+    glfwInit();
+    markStartupPhase(startup, "glfwInit");
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT,
+                   options.debugOutput ? GLFW_TRUE : GLFW_FALSE);
+
+    // Tworzenie okna
+    window = glfwCreateWindow(window_width, window_height,
+                              "grafika komputerowa", NULL, NULL);
+    if (window == NULL) {
+      std::cout << "Failed to create GLFW window" << std::endl;
+      glfwTerminate();
+      return -1;
+    }
 
-  glfwMakeContextCurrent(window);
-  glfwSetScrollCallback(window, scroll_callback);
+    glfwMakeContextCurrent(window);
+    markStartupPhase(startup, "window");
+    glfwSetScrollCallback(window, scroll_callback);
+  }
 
   // inicjalizacja GLAD
-  if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+  GLADloadproc loader = options.headless ? (GLADloadproc)headlessGetProcAddress
+                                         : (GLADloadproc)glfwGetProcAddress;
+  if (!gladLoadGLLoader(loader)) {
     std::cout << "Failed to initialize GLAD" << std::endl;
     return -1;
   }
 
-  GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-  glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-  glCompileShader(vertexShader);
-
-  GLint status;
-  GLchar error_message[512];
-  glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &status);
-  if (!status) {
-    glGetShaderInfoLog(vertexShader, 512, NULL, error_message);
-    std::cout << "Error (Vertex shader): " << error_message << std::endl;
-  }
-
-  GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-  glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-  glCompileShader(fragmentShader);
-  glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &status);
-  if (!status) {
-    glGetShaderInfoLog(fragmentShader, 512, NULL, error_message);
-    std::cout << "Error (Fragment shader): " << error_message << std::endl;
-  }
-
-  GLuint shaderProgram = glCreateProgram();
-  glAttachShader(shaderProgram, vertexShader);
-  glAttachShader(shaderProgram, fragmentShader);
-  glLinkProgram(shaderProgram);
-
-  glGetProgramiv(shaderProgram, GL_LINK_STATUS, &status);
-  if (!status) {
-    glGetProgramInfoLog(shaderProgram, 512, NULL, error_message);
-    std::cout << "Error (Shader program): " << error_message << std::endl;
-  }
+  if (options.glCounters)
+    installGlCounters();
+  if (options.debugOutput)
+    enableDebugOutput(loader);
+  initParallelShaderCompile(loader);
+  if (options.shaderCache != NULL)
+    initShaderCache(options.shaderCache, loader);
+  if (options.spirv != NULL || options.dumpShaders != NULL)
+    initSpirvShaders(options.spirv, options.dumpShaders, loader);
+  if (options.hotReload)
+    initShaderHotReload();
+
+  if (options.headless &&
+      !createHeadlessFramebuffer(headless, window_width, window_height))
+    return -1;
+  if (options.overdraw)
+    enableOverdraw();
+  markStartupPhase(startup, "glad");
 
-  glDetachShader(shaderProgram, vertexShader);
-  glDetachShader(shaderProgram, fragmentShader);
+  ShaderVariants shapeShader = shaderVariants(loadShaderFile("shape.vert"),
+                                              loadShaderFile("shape.frag"));
+  watchShaderVariants(shapeShader, "shape.vert", "shape.frag");
+  submitShaderVariant(shapeShader, 0);
+  markStartupPhase(startup, "shaders");
 
   GLfloat vertices[] = {
     -0.5f, -0.5f, 0.0f, // Vertex 0 
@@ -147,10 +152,8 @@ int main() {
   glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 
 
-  GLuint EBO;
-  glGenBuffers(1, &EBO);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+  IndexBuffer EBO =
+      createIndexBuffer(indices, sizeof(indices) / sizeof(indices[0]));
 
 
   glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat),
@@ -162,38 +165,83 @@ int main() {
   glViewport(0, 0, (GLuint)window_width, (GLuint)window_height);
 
 
-  int scrollOffsetLocation = glGetUniformLocation(shaderProgram, "scrollOffset");
-  int colorLocation = glGetUniformLocation(shaderProgram, "shapeColor");
+  shaderVariant(shapeShader, 0);
+  // bound for each program, again after --hot-reload replaced it
+  unsigned shaderGeneration = ~0u;
+  ParameterBlock materials = createParameterBlock(sizeof(Material), 2);
   GLfloat defaultColor[] = {0.0f, 1.0f, 0.0f};
 
+  FrameStats frameStats;
+  initFrameStats(frameStats);
+
+  GpuProfiler gpuProfiler;
+  gpuProfiler.enabled = options.gpuProfile || options.bench != NULL;
+
+  markStartupPhase(startup, "scene");
+  double cpuStart = processCpuTime();
+  double previousTime = runTime(window);
+
   // pętla zdarzeń
-  while (!glfwWindowShouldClose(window)) {
-    keyPressPooling(window);
+  long frame = 0;
+  while (keepRunning(window, options, frame)) {
+    pollShaderFiles();
+    beginGpuFrame(gpuProfiler);
+    pushGpuScope(gpuProfiler, "frame");
+
+    if (window != NULL)
+      keyPressPooling(window);
 
     glClearColor(0.18f, 0.2f, 0.22f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT);
 
-    glUseProgram(shaderProgram);
+    const ShaderVariant &shader = shaderVariant(shapeShader, 0);
+    if (shader.generation != shaderGeneration) {
+      bindUniformBlock(shader.program, "Material", materialBinding,
+                       sizeof(Material));
+      shaderGeneration = shader.generation;
+    }
+    glUseProgram(shader.program);
 
-    glUniform1f(scrollOffsetLocation, scrollOffset);
-    glUniform3fv(colorLocation, 1, defaultColor);
+    // only fields that changed since the last frame reach the buffer
+    setParameter(materials, 0, offsetof(Material, shapeColor), defaultColor);
+    setParameter(materials, 0, offsetof(Material, scrollOffset), scrollOffset);
+    setParameter(materials, 1, offsetof(Material, shapeColor),
+                 colors[colorIndex]);
 
     glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-    glUniform3fv(colorLocation, 1, colors[colorIndex]);
-    glUniform1f(scrollOffsetLocation, 0);
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, (void*)(6 * sizeof(GLuint))); 
+    bindParameterBlock(materials, 0, materialBinding);
+    drawIndices(GL_TRIANGLES, EBO, 0, 6);
+    bindParameterBlock(materials, 1, materialBinding);
+    drawIndices(GL_TRIANGLES, EBO, 6, 6);
     glBindVertexArray(0);
 
-    glfwSwapBuffers(window);
-    glfwPollEvents();
+    popGpuScope(gpuProfiler);
+    endGpuFrame(gpuProfiler);
+    endGlCounterFrame();
+
+    presentFrame(window);
+    if (frame == 0)
+      markFirstFrame(startup);
+
+    double currentTime = runTime(window);
+    recordFrame(frameStats, currentTime - previousTime);
+    previousTime = currentTime;
+    frame++;
   }
 
+  bool passed = reportRun(options, "l4", 1, frameStats, gpuProfiler, startup,
+                          processCpuTime() - cpuStart);
+  destroyGpuProfiler(gpuProfiler);
+
   glDeleteVertexArrays(1, &VAO);
   glDeleteBuffers(1, &VBO);
-  glDeleteBuffers(1, &EBO);
-  glDeleteProgram(shaderProgram);
+  deleteIndexBuffer(EBO);
+  deleteShaderVariants(shapeShader);
+  deleteParameterBlock(materials);
 
-  glfwTerminate();
-  return 0;
+  if (options.headless)
+    destroyHeadlessContext(headless);
+  else
+    glfwTerminate();
+  return passed ? 0 : 1;
 }
\ No newline at end of file
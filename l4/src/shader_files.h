@@ -0,0 +1,185 @@
+#ifndef SHADER_FILES_H
+#define SHADER_FILES_H
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "shader.h"
+
+// Shader sources live in the lab's shaders/ directory, read relative to src/
+// like the textures. A line #include "file" is replaced by that file (also
+// from shaders/), so shared blocks are written once.
+//
+// With --hot-reload the directory is watched with inotify. pollShaderFiles()
+// runs once per frame: a changed file rebuilds only the sets that read it,
+// directly or through an include, and the old programs keep drawing until
+// the new ones link (see replaceShaderSources). The rebuild overlaps the
+// frame loop through KHR_parallel_shader_compile rather than a second GL
+// context; drivers without it wait for the link in the frame that polls it.
+// inotify is Linux only; elsewhere --hot-reload reports that it is not
+// supported and pollShaderFiles does nothing.
+const char *const shaderDirectory = "../shaders";
+
+struct WatchedShaders {
+  ShaderVariants *set;
+  std::string vertexFile;
+  std::string fragmentFile;
+  std::vector<std::string> files; // both stages and everything they include
+};
+
+struct ShaderFilesState {
+  int inotify = -1; // watching when >= 0
+  std::vector<WatchedShaders> watched;
+};
+
+inline ShaderFilesState &shaderFiles() {
+  static ShaderFilesState state;
+  return state;
+}
+
+// appends the file to text, includes expanded; every file read is added to
+// files. Returns false (and prints the file) when something is missing.
+inline bool readShaderFile(const std::string &file, std::string &text,
+                           std::vector<std::string> &files, int depth = 0) {
+  if (depth > 16) {
+    std::cout << "Shader includes nested too deep in " << file << std::endl;
+    return false;
+  }
+  if (std::find(files.begin(), files.end(), file) == files.end())
+    files.push_back(file);
+
+  std::string path = std::string(shaderDirectory) + "/" + file;
+  FILE *stream = std::fopen(path.c_str(), "rb");
+  if (stream == NULL) {
+    std::cout << "Failed to read shader " << path << std::endl;
+    return false;
+  }
+  std::string source;
+  char buffer[4096];
+  size_t read;
+  while ((read = std::fread(buffer, 1, sizeof(buffer), stream)) > 0)
+    source.append(buffer, read);
+  std::fclose(stream);
+
+  bool ok = true;
+  size_t start = 0;
+  while (start < source.size()) {
+    size_t end = source.find('\n', start);
+    end = end == std::string::npos ? source.size() : end + 1;
+    std::string line = source.substr(start, end - start);
+    size_t open = line.find('"');
+    size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+    if (line.compare(0, 8, "#include") == 0 && close != std::string::npos)
+      ok = readShaderFile(line.substr(open + 1, close - open - 1), text, files,
+                          depth + 1) &&
+           ok;
+    else
+      text += line;
+    start = end;
+  }
+  return ok;
+}
+
+// the source of one stage, empty when it could not be read
+inline std::string loadShaderFile(const char *file) {
+  std::string text;
+  std::vector<std::string> files;
+  return readShaderFile(file, text, files) ? text : std::string();
+}
+
+// call after gladLoadGLLoader when --hot-reload is given
+inline bool initShaderHotReload() {
+#ifdef __linux__
+  ShaderFilesState &state = shaderFiles();
+  state.inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  // editors save by writing in place or by renaming a new file over it
+  if (state.inotify < 0 ||
+      inotify_add_watch(state.inotify, shaderDirectory,
+                        IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+    std::cout << "Failed to watch " << shaderDirectory
+              << ", shader hot reload disabled" << std::endl;
+    if (state.inotify >= 0)
+      close(state.inotify);
+    state.inotify = -1;
+    return false;
+  }
+  return true;
+#else
+  std::cout << "Shader hot reload is not supported on this platform"
+            << std::endl;
+  return false;
+#endif
+}
+
+// Rebuilds set from the two files whenever one of them, or a file they
+// include, changes. The set must stay where it is while watched (a local in
+// main). Does nothing without --hot-reload.
+inline void watchShaderVariants(ShaderVariants &set, const char *vertexFile,
+                                const char *fragmentFile) {
+  ShaderFilesState &state = shaderFiles();
+  if (state.inotify < 0)
+    return;
+
+  WatchedShaders watched;
+  watched.set = &set;
+  watched.vertexFile = vertexFile;
+  watched.fragmentFile = fragmentFile;
+  std::string text;
+  readShaderFile(vertexFile, text, watched.files);
+  readShaderFile(fragmentFile, text, watched.files);
+  state.watched.push_back(watched);
+}
+
+inline void reloadWatchedShaders(WatchedShaders &watched) {
+  std::vector<std::string> files;
+  std::string vertexSource, fragmentSource;
+  bool ok = readShaderFile(watched.vertexFile, vertexSource, files);
+  ok = readShaderFile(watched.fragmentFile, fragmentSource, files) && ok;
+  if (!ok)
+    return; // half-written or deleted; the next event tries again
+
+  watched.files = files; // includes may have been added or removed
+  replaceShaderSources(*watched.set, vertexSource, fragmentSource);
+}
+
+// call once per frame; never blocks
+inline void pollShaderFiles() {
+#ifdef __linux__
+  ShaderFilesState &state = shaderFiles();
+  if (state.inotify < 0)
+    return;
+
+  std::vector<std::string> changed;
+  alignas(inotify_event) char buffer[4096];
+  ssize_t length;
+  while ((length = read(state.inotify, buffer, sizeof(buffer))) > 0) {
+    for (ssize_t offset = 0; offset < length;) {
+      const inotify_event *event = (const inotify_event *)(buffer + offset);
+      if (event->len > 0 && std::find(changed.begin(), changed.end(),
+                                      event->name) == changed.end())
+        changed.push_back(event->name);
+      offset += sizeof(inotify_event) + event->len;
+    }
+  }
+
+  for (WatchedShaders &watched : state.watched) {
+    for (const std::string &file : changed) {
+      if (std::find(watched.files.begin(), watched.files.end(), file) !=
+          watched.files.end()) {
+        reloadWatchedShaders(watched);
+        break;
+      }
+    }
+  }
+#endif
+}
+
+#endif
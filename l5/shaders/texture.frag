@@ -0,0 +1,16 @@
+#version 330 core
+in vec3 vertexColor;
+in vec2 vertexTexture;
+out vec4 fragmentColor;
+uniform sampler2D uniTexture;
+#ifdef SCROLL_TINT
+uniform float uniScroll;
+#endif
+void main()
+{
+#ifdef SCROLL_TINT
+    fragmentColor = mix(texture(uniTexture, vertexTexture), vec4(0.30f, 0.50f, 1.0f, 0.0f), uniScroll);
+#else
+    fragmentColor = texture(uniTexture, vertexTexture);
+#endif
+}
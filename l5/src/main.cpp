@@ -6,31 +6,19 @@
 
 #include <iostream>
 
-const GLchar *vertexShaderSource =
-    "#version 330 core\n"
-    "layout(location = 0) in vec3 position;\n"
-    "layout(location = 1) in vec3 color;\n"
-    "layout(location = 2) in vec2 texture;\n"
-    "out vec3 vertexColor;\n"
-    "out vec2 vertexTexture;\n"
-    "void main()\n"
-    "{\n"
-    " gl_Position = vec4(position.x, position.y, position.z, 1.0);\n"
-    " vertexColor = color;\n"
-    " vertexTexture = texture;\n"
-    "}\0";
-
-const GLchar *fragmentShaderSource =
-    "#version 330 core\n"
-    "in vec3 vertexColor;\n"
-    "in vec2 vertexTexture;\n"
-    "out vec4 fragmentColor;\n"
-    "uniform sampler2D uniTexture;\n"
-    "uniform float uniScroll;\n"
-    "void main()\n"
-    "{\n"
-    "    fragmentColor = mix(texture(uniTexture, vertexTexture), vec4(0.30f, 0.50f, 1.0f, 0.0f), uniScroll);\n"
-    "}\0";
+#include "bench.h"
+#include "headless.h"
+#include "index_buffer.h"
+#include "parameter_block.h"
+#include "pipeline.h"
+#include "shader.h"
+#include "shader_files.h"
+#include "vertex_format.h"
+
+// shaders/texture.*: SCROLL_TINT blends the texture towards blue by
+// uniScroll; while the wheel has not been touched the plain texture variant
+// runs without the uniform
+enum TextureFeature { SCROLL_TINT = 1 << 0 };
 
 float scrollOffset = 0.0f;
 
@@ -40,15 +28,36 @@ void scroll_callback(GLFWwindow *window, double xoffset, double yoffset) {
     if(scrollOffset > 1.0) scrollOffset = 1.0;
 }
 
+// uniScroll of the SCROLL_TINT variant, looked up again when --hot-reload
+// replaced the program
+struct ScrollUniform {
+  GLint location = -1;
+  unsigned generation = ~0u;
+  UniformShadow shadow;
+};
+
+void setScrollUniform(ScrollUniform &uniform, const ShaderVariant &variant) {
+  if (!(variant.features & SCROLL_TINT))
+    return;
+  if (variant.generation != uniform.generation) {
+    uniform.location = uniformLocation(variant.uniforms, "uniScroll", GL_FLOAT);
+    uniform.generation = variant.generation;
+    resetUniformShadow(uniform.shadow);
+  }
+  shadowUniform1f(uniform.shadow, uniform.location, scrollOffset);
+}
+
+// which shapes are drawn: keys 1, 2 and 3 pick the quad, the triangle or both
+enum DrawMode { DRAW_QUAD = 1 << 0, DRAW_TRIANGLE = 1 << 1 };
 int mode = 0;
 
 void processInput(GLFWwindow *window) {
   if (glfwGetKey(window, GLFW_KEY_1) == GLFW_PRESS) {
-      mode = 1;  
+      mode = DRAW_QUAD;
   } else if (glfwGetKey(window, GLFW_KEY_2) == GLFW_PRESS) {
-      mode = 2; 
+      mode = DRAW_TRIANGLE;
   } else if (glfwGetKey(window, GLFW_KEY_3) == GLFW_PRESS) {
-      mode = 3;  
+      mode = DRAW_QUAD | DRAW_TRIANGLE;
   }
 }
 
@@ -57,88 +66,76 @@ void processInputKeyboard(GLFWwindow* window){
       glfwSetWindowShouldClose(window, true);
 }
 
-int main() {
-  // inicjalizacja GLFW
-  glfwInit();
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+int main(int argc, char **argv) {
+  StartupProfile startup;
+  RunOptions options = parseRunOptions(argc, argv);
 
-  // Tworzenie okna
   const unsigned int window_width = 1000;
   const unsigned int window_height = 1000;
-  GLFWwindow *window = glfwCreateWindow(window_width, window_height,
-                                        "grafika komputerowa", NULL, NULL);
-  if (window == NULL) {
-    std::cout << "Failed to create GLFW window" << std::endl;
-    glfwTerminate();
-    return -1;
+  GLFWwindow *window = NULL;
+  HeadlessContext headless;
+
+  if (options.headless) {
+    if (!createHeadlessContext(headless, window_width, window_height,
+                               options.debugOutput))
+      return -1;
+    markStartupPhase(startup, "egl context");
+  } else {
+    // inicjalizacja GLFW
+    glfwInit();
+    markStartupPhase(startup, "glfwInit");
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT,
+                   options.debugOutput ? GLFW_TRUE : GLFW_FALSE);
+
+    // Tworzenie okna
+    window = glfwCreateWindow(window_width, window_height,
+                              "grafika komputerowa", NULL, NULL);
+    if (window == NULL) {
+      std::cout << "Failed to create GLFW window" << std::endl;
+      glfwTerminate();
+      return -1;
+    }
+    glfwMakeContextCurrent(window);
+    markStartupPhase(startup, "window");
   }
 
-  glfwMakeContextCurrent(window);
-
   // inicjalizacja GLAD
-  if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+  GLADloadproc loader = options.headless ? (GLADloadproc)headlessGetProcAddress
+                                         : (GLADloadproc)glfwGetProcAddress;
+  if (!gladLoadGLLoader(loader)) {
     std::cout << "Failed to initialize GLAD" << std::endl;
     return -1;
   }
 
-  GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-  glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-  glCompileShader(vertexShader);
-
-  glEnable(GL_DEPTH_TEST);
-
-  GLint status;
-  GLchar error_message[512];
-  glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &status);
-  if (!status) {
-    glGetShaderInfoLog(vertexShader, 512, NULL, error_message);
-    std::cout << "Error (Vertex shader): " << error_message << "\n";
-  }
-
-  GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-  glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-  glCompileShader(fragmentShader);
-
-  glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &status);
-  if (!status) {
-    glGetShaderInfoLog(fragmentShader, 512, NULL, error_message);
-    std::cout << "Error (Fragment shader): " << error_message << "\n";
-  }
-
-  GLuint shaderProgram = glCreateProgram();
-  glAttachShader(shaderProgram, vertexShader);
-  glAttachShader(shaderProgram, fragmentShader);
-  glLinkProgram(shaderProgram);
-
-  glGetProgramiv(shaderProgram, GL_LINK_STATUS, &status);
-  if (!status) {
-    glGetProgramInfoLog(shaderProgram, 512, NULL, error_message);
-    std::cout << "Error (Shader program): " << error_message << "\n";
-  }
-
-  glDetachShader(shaderProgram, vertexShader);
-  
-  GLfloat vertices[] = {
-      -0.8f, -0.3f, 0.0f,    1.0f, 0.0f, 0.0f,   0.0f, 0.0f,
-      -0.2f, -0.3f, 0.0f,    1.0f, 0.0f, 0.0f,   1.0f, 0.0f, 
-      -0.2f, 0.3f, 0.0f,    1.0f, 0.0f, 0.0f,   1.0f, 1.0f, 
-      -0.8f, 0.3f, 0.0f,    1.0f, 0.0f, 0.0f,   0.0f, 1.0f, 
-      0.2f, -0.3f, 0.0f,   1.0f, 0.0f, 0.0f,   0.0f, 0.0f,      
-      0.8f, -0.3f, 0.0f,    1.0f, 0.0f, 0.0f,   1.0f, 0.0f,      
-      0.5f, 0.3f, 0.0f,   1.0f, 0.0f, 0.0f,   0.5f, 1.0f,     
-  };
-
-  GLuint indices[] = {
-    0, 1, 2,
-    0, 2, 3,
-    4, 5, 6     
-  };
-  glDetachShader(shaderProgram, fragmentShader);
-
-  glDeleteShader(vertexShader);
-  glDeleteShader(fragmentShader);
+  if (options.glCounters)
+    installGlCounters();
+  if (options.debugOutput)
+    enableDebugOutput(loader);
+  initParallelShaderCompile(loader);
+  if (options.shaderCache != NULL)
+    initShaderCache(options.shaderCache, loader);
+  if (options.spirv != NULL || options.dumpShaders != NULL)
+    initSpirvShaders(options.spirv, options.dumpShaders, loader);
+  if (options.hotReload)
+    initShaderHotReload();
+
+  if (options.headless &&
+      !createHeadlessFramebuffer(headless, window_width, window_height))
+    return -1;
+  if (options.overdraw)
+    enableOverdraw();
+  markStartupPhase(startup, "glad");
+
+  ShaderVariants textureShader =
+      shaderVariants(loadShaderFile("texture.vert"),
+                     loadShaderFile("texture.frag"), {"SCROLL_TINT"});
+  watchShaderVariants(textureShader, "texture.vert", "texture.frag");
+  // the tinted variant is only compiled once the wheel is scrolled
+  submitShaderVariant(textureShader, 0);
+  markStartupPhase(startup, "shaders");
 
   int width_first, height_first, nrChannels_first;
   stbi_set_flip_vertically_on_load(true);
@@ -172,6 +169,7 @@ int main() {
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  markStartupPhase(startup, "textures");
 
   GLfloat vertices[] = {
       -0.9f, -0.5f, 0.0f,    1.0f, 0.0f, 0.0f,   0.0f, 0.0f,
@@ -193,73 +191,102 @@ int main() {
   glGenVertexArrays(1, &VAO);
   glBindVertexArray(VAO);
 
-  GLuint VBO;
-  glGenBuffers(1, &VBO);
-  glBindBuffer(GL_ARRAY_BUFFER, VBO);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-  GLuint EBO;
-  glGenBuffers(1, &EBO);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices,
-               GL_STATIC_DRAW);
-
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat),
-                        (void *)0);
-  glEnableVertexAttribArray(0);
-  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat),
-                        (void *)(3 * sizeof(GLfloat)));
-  glEnableVertexAttribArray(1);
-  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat),
-                        (void *)(6 * sizeof(GLfloat)));
-  glEnableVertexAttribArray(2);
+  // 16 bytes a vertex instead of 32; the UVs stay within 0..1
+  VertexFormat format = vertexFormat({{0, 3, VERTEX_SNORM16},
+                                      {1, 3, VERTEX_UNORM8},
+                                      {2, 2, VERTEX_UNORM16}});
+  GLuint VBO = createVertexBuffer(format, vertices, 7);
+
+  IndexBuffer EBO =
+      createIndexBuffer(indices, sizeof(indices) / sizeof(indices[0]));
 
   glBindVertexArray(0);
 
+  // both shapes share shader, layout and depth test; only the texture differs
+  PipelineState quadState;
+  quadState.shader = &textureShader;
+  quadState.vertexArray = VAO;
+  quadState.depthTest = true;
+  quadState.textures[0] = textures[0];
+  Pipeline quadPipeline = bakePipeline(quadState);
+  PipelineState triangleState = quadState;
+  triangleState.textures[0] = textures[1];
+  Pipeline trianglePipeline = bakePipeline(triangleState);
+
   glViewport(0, 0, (GLuint)window_width, (GLuint)window_height);
 
-  glfwSetScrollCallback(window, scroll_callback);
+  if (window != NULL) {
+    glfwSetScrollCallback(window, scroll_callback);
+  } else {
+    // bez klawiatury pokazujemy obie tekstury
+    mode = DRAW_QUAD | DRAW_TRIANGLE;
+  }
+
+  FrameStats frameStats;
+  initFrameStats(frameStats);
+
+  GpuProfiler gpuProfiler;
+  gpuProfiler.enabled = options.gpuProfile || options.bench != NULL;
+
+  shaderVariant(textureShader, 0);
+  ScrollUniform scrollUniform;
+  markStartupPhase(startup, "scene");
+  double cpuStart = processCpuTime();
+  double previousTime = runTime(window);
 
   // pętla zdarzeń
-  while (!glfwWindowShouldClose(window)) {
+  long frame = 0;
+  while (keepRunning(window, options, frame)) {
+    pollShaderFiles();
+    beginGpuFrame(gpuProfiler);
+    pushGpuScope(gpuProfiler, "frame");
+
     glClearColor(0.18f, 0.2f, 0.22f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT);
+    // both pipelines depth test, so depth is cleared with the color
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    glUseProgram(shaderProgram);
-    glBindVertexArray(VAO);
+    unsigned features = scrollOffset > 0.0f ? SCROLL_TINT : 0;
 
-    if (mode == 1) {
-      glBindTexture(GL_TEXTURE_2D, textures[0]);
-      glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    if (mode & DRAW_QUAD) {
+      setScrollUniform(scrollUniform, applyPipeline(quadPipeline, features));
+      drawIndices(GL_TRIANGLES, EBO, 0, 6);
     }
 
-    if (mode == 2) {
-      glBindTexture(GL_TEXTURE_2D, textures[1]);
-      glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_INT, (void *)(6 * sizeof(GLuint)));
+    if (mode & DRAW_TRIANGLE) {
+      setScrollUniform(scrollUniform,
+                       applyPipeline(trianglePipeline, features));
+      drawIndices(GL_TRIANGLES, EBO, 6, 3);
     }
 
-    if (mode == 3) {
-      glBindTexture(GL_TEXTURE_2D, textures[0]);
-      glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    popGpuScope(gpuProfiler);
+    endGpuFrame(gpuProfiler);
+    endGlCounterFrame();
 
-      glBindTexture(GL_TEXTURE_2D, textures[1]);
-      glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_INT, (void *)(6 * sizeof(GLuint)));
-    }
-
-    int scrollLocation = glGetUniformLocation(shaderProgram, "uniScroll");
-    glUniform1f(scrollLocation, scrollOffset);
+    presentFrame(window);
+    if (frame == 0)
+      markFirstFrame(startup);
 
-    glfwSwapBuffers(window);
-    glfwPollEvents();
+    double currentTime = runTime(window);
+    recordFrame(frameStats, currentTime - previousTime);
+    previousTime = currentTime;
+    frame++;
 
-    processInput(window);
+    if (window != NULL)
+      processInput(window);
   }
 
+  bool passed = reportRun(options, "l5", 1, frameStats, gpuProfiler, startup,
+                          processCpuTime() - cpuStart);
+  destroyGpuProfiler(gpuProfiler);
+
   glDeleteVertexArrays(1, &VAO);
   glDeleteBuffers(1, &VBO);
-  glDeleteBuffers(1, &EBO);
-  glDeleteProgram(shaderProgram);
+  deleteIndexBuffer(EBO);
+  deleteShaderVariants(textureShader);
 
-  glfwTerminate();
-  return 0;
+  if (options.headless)
+    destroyHeadlessContext(headless);
+  else
+    glfwTerminate();
+  return passed ? 0 : 1;
 }
\ No newline at end of file
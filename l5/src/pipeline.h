@@ -0,0 +1,130 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <glad/glad.h>
+
+#include "shader.h"
+
+// Pipeline state objects: the shader, vertex layout (VAO), fixed-function
+// state and textures of a draw, fixed when the pipeline is baked. Applying a
+// pipeline compares it with the state the previous one left behind and only
+// issues the GL calls for what differs, so switching between two pipelines
+// that share most of their state costs a call or two.
+//
+// The shader is a ShaderVariants set plus feature mask rather than a program,
+// so lazily built permutations and --hot-reload keep working; features only
+// known per frame can be added when applying. Code that changes any of this
+// state without a pipeline must call resetPipelineState() so the next apply
+// sets everything again.
+const int pipelineTextureUnits = 4;
+
+struct PipelineState {
+  ShaderVariants *shader = NULL;
+  unsigned features = 0;
+  GLuint vertexArray = 0;
+  bool depthTest = false;
+  bool blend = false;
+  GLenum blendSource = GL_ONE;
+  GLenum blendDestination = GL_ZERO;
+  bool cullFace = false;
+  GLuint textures[pipelineTextureUnits] = {0}; // GL_TEXTURE_2D per unit
+};
+
+// immutable once baked
+class Pipeline {
+public:
+  explicit Pipeline(const PipelineState &state) : state(state) {}
+  const PipelineState state;
+};
+
+inline Pipeline bakePipeline(const PipelineState &state) {
+  return Pipeline(state);
+}
+
+// what the last applied pipeline left bound and enabled
+struct AppliedPipelineState {
+  bool valid = false; // false: nothing is known, set everything
+  GLuint program = 0;
+  GLuint vertexArray = 0;
+  bool depthTest = false;
+  bool blend = false;
+  GLenum blendSource = GL_ONE;
+  GLenum blendDestination = GL_ZERO;
+  bool cullFace = false;
+  GLuint textures[pipelineTextureUnits] = {0};
+  GLenum activeTexture = GL_TEXTURE0;
+};
+
+inline AppliedPipelineState &appliedPipelineState() {
+  static AppliedPipelineState state;
+  return state;
+}
+
+inline void resetPipelineState() { appliedPipelineState().valid = false; }
+
+inline void setCapability(GLenum capability, bool enabled) {
+  if (enabled)
+    glEnable(capability);
+  else
+    glDisable(capability);
+}
+
+// binds the pipeline's variant (its features plus extraFeatures) and returns
+// it, for setting uniforms
+inline const ShaderVariant &applyPipeline(const Pipeline &pipeline,
+                                          unsigned extraFeatures = 0) {
+  const PipelineState &next = pipeline.state;
+  AppliedPipelineState &current = appliedPipelineState();
+  bool all = !current.valid;
+
+  const ShaderVariant &variant =
+      shaderVariant(*next.shader, next.features | extraFeatures);
+  if (all || current.program != variant.program) {
+    glUseProgram(variant.program);
+    current.program = variant.program;
+  }
+  if (all || current.vertexArray != next.vertexArray) {
+    glBindVertexArray(next.vertexArray);
+    current.vertexArray = next.vertexArray;
+  }
+  if (all || current.depthTest != next.depthTest) {
+    setCapability(GL_DEPTH_TEST, next.depthTest);
+    current.depthTest = next.depthTest;
+  }
+  if (all || current.blend != next.blend) {
+    setCapability(GL_BLEND, next.blend);
+    current.blend = next.blend;
+  }
+  if (all || current.blendSource != next.blendSource ||
+      current.blendDestination != next.blendDestination) {
+    glBlendFunc(next.blendSource, next.blendDestination);
+    current.blendSource = next.blendSource;
+    current.blendDestination = next.blendDestination;
+  }
+  if (all || current.cullFace != next.cullFace) {
+    setCapability(GL_CULL_FACE, next.cullFace);
+    current.cullFace = next.cullFace;
+  }
+  for (int unit = 0; unit < pipelineTextureUnits; unit++) {
+    // units a pipeline does not use keep whatever is bound (0 = not known)
+    if (next.textures[unit] == 0) {
+      if (all)
+        current.textures[unit] = 0;
+      continue;
+    }
+    if (!all && current.textures[unit] == next.textures[unit])
+      continue;
+    GLenum texture = GL_TEXTURE0 + unit;
+    if (all || current.activeTexture != texture) {
+      glActiveTexture(texture);
+      current.activeTexture = texture;
+    }
+    glBindTexture(GL_TEXTURE_2D, next.textures[unit]);
+    current.textures[unit] = next.textures[unit];
+  }
+
+  current.valid = true;
+  return variant;
+}
+
+#endif
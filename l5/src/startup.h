@@ -0,0 +1,68 @@
+#ifndef STARTUP_H
+#define STARTUP_H
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+// Startup broken into phases (context, GLAD, shaders, textures, scene) plus
+// the time until the first frame has been presented. The clock starts when
+// the StartupProfile is constructed, so declare it first thing in main.
+struct StartupPhase {
+  const char *name;
+  double seconds;
+};
+
+struct StartupProfile {
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  std::chrono::steady_clock::time_point last = start;
+  std::vector<StartupPhase> phases;
+  double firstFrame = -1.0; // seconds, < 0 until the first frame is presented
+};
+
+// closes the phase that started at the previous mark
+inline void markStartupPhase(StartupProfile &startup, const char *name) {
+  if (startup.firstFrame >= 0.0)
+    return;
+
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  StartupPhase phase = {
+      name, std::chrono::duration<double>(now - startup.last).count()};
+  startup.phases.push_back(phase);
+  startup.last = now;
+}
+
+// call after presenting frame 0; later calls are ignored
+inline void markFirstFrame(StartupProfile &startup) {
+  if (startup.firstFrame >= 0.0)
+    return;
+
+  markStartupPhase(startup, "first frame");
+  startup.firstFrame =
+      std::chrono::duration<double>(startup.last - startup.start).count();
+}
+
+inline void printStartupProfile(const StartupProfile &startup) {
+  if (startup.firstFrame < 0.0)
+    return;
+
+  std::printf("startup: %.3f ms to first frame\n", startup.firstFrame * 1000.0);
+  for (const StartupPhase &phase : startup.phases)
+    std::printf("  %-20s %.3f ms\n", phase.name, phase.seconds * 1000.0);
+}
+
+// budget in milliseconds, <= 0 means no budget
+inline bool withinStartupBudget(const StartupProfile &startup,
+                                double budget) {
+  if (budget <= 0.0 || startup.firstFrame < 0.0)
+    return true;
+  if (startup.firstFrame * 1000.0 <= budget)
+    return true;
+
+  std::printf("startup budget exceeded: %.3f ms > %.3f ms\n",
+              startup.firstFrame * 1000.0, budget);
+  return false;
+}
+
+#endif
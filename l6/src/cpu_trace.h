@@ -0,0 +1,127 @@
+#ifndef CPU_TRACE_H
+#define CPU_TRACE_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+#include "overdraw.h"
+
+// CPU side of the render loop as a Chrome trace (--trace F). Scopes are
+// recorded as complete ("X") events into a buffer reserved up front and
+// written on exit; the file opens in Perfetto or chrome://tracing. When the
+// trace is disabled push/pop return after a single branch.
+struct CpuTraceEvent {
+  const char *name;
+  double begin; // microseconds since initCpuTrace
+  double end;
+};
+
+struct CpuTrace {
+  bool enabled = false;
+  std::chrono::steady_clock::time_point start;
+  std::vector<CpuTraceEvent> events;
+  std::vector<size_t> open; // indices into events, dropped scopes are ~0
+  long droppedEvents = 0;
+};
+
+inline double cpuTraceNow(const CpuTrace &trace) {
+  return std::chrono::duration<double, std::micro>(
+             std::chrono::steady_clock::now() - trace.start)
+      .count();
+}
+
+inline void initCpuTrace(CpuTrace &trace, bool enabled,
+                         size_t capacity = 1 << 20) {
+  trace.enabled = enabled;
+  if (!enabled)
+    return;
+  trace.start = std::chrono::steady_clock::now();
+  trace.events.reserve(capacity);
+  trace.open.reserve(64);
+}
+
+inline void pushCpuScope(CpuTrace &trace, const char *name) {
+  if (!trace.enabled)
+    return;
+
+  // a full buffer stops recording rather than reallocating mid-frame
+  if (trace.events.size() == trace.events.capacity()) {
+    trace.droppedEvents++;
+    trace.open.push_back((size_t)-1);
+    return;
+  }
+  trace.open.push_back(trace.events.size());
+  CpuTraceEvent event = {name, cpuTraceNow(trace), 0.0};
+  trace.events.push_back(event);
+}
+
+inline void popCpuScope(CpuTrace &trace) {
+  if (!trace.enabled || trace.open.empty())
+    return;
+
+  size_t index = trace.open.back();
+  trace.open.pop_back();
+  if (index != (size_t)-1)
+    trace.events[index].end = cpuTraceNow(trace);
+}
+
+// glfwSwapBuffers and glfwPollEvents as separate scopes; same as
+// presentFrame otherwise
+inline void presentTracedFrame(GLFWwindow *window, CpuTrace &trace) {
+  pushCpuScope(trace, "overdraw");
+  endOverdrawFrame();
+  popCpuScope(trace);
+
+  if (window == NULL) {
+    pushCpuScope(trace, "glFinish");
+    glFinish();
+    popCpuScope(trace);
+    return;
+  }
+
+  pushCpuScope(trace, "glfwSwapBuffers");
+  glfwSwapBuffers(window);
+  popCpuScope(trace);
+
+  pushCpuScope(trace, "glfwPollEvents");
+  glfwPollEvents();
+  popCpuScope(trace);
+}
+
+inline bool writeCpuTrace(const CpuTrace &trace, const char *path) {
+  if (!trace.enabled)
+    return true;
+
+  FILE *file = std::fopen(path, "w");
+  if (file == NULL) {
+    std::cout << "Failed to write " << path << std::endl;
+    return false;
+  }
+
+  std::fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+  bool first = true;
+  for (const CpuTraceEvent &event : trace.events) {
+    if (event.end < event.begin)
+      continue; // never closed
+    std::fprintf(file,
+                 "%s{\"name\": \"%s\", \"cat\": \"cpu\", \"ph\": \"X\", "
+                 "\"ts\": %.3f, \"dur\": %.3f, \"pid\": 1, \"tid\": 1}",
+                 first ? "" : ",\n", event.name, event.begin,
+                 event.end - event.begin);
+    first = false;
+  }
+  std::fprintf(file, "\n]}\n");
+  std::fclose(file);
+
+  if (trace.droppedEvents > 0)
+    std::cout << "CPU trace buffer full, " << trace.droppedEvents
+              << " scopes dropped" << std::endl;
+  return true;
+}
+
+#endif
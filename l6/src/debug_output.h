@@ -0,0 +1,204 @@
+#ifndef DEBUG_OUTPUT_H
+#define DEBUG_OUTPUT_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "shader.h"
+
+// GL_KHR_debug message log for --debug-output. The driver reports slow paths
+// here (shader recompiles, format conversions, buffer migrations, ...);
+// identical messages are merged and printed on exit, most frequent first.
+// glad is generated for core 3.3 only, so the entry points and enums of
+// KHR_debug (core in 4.3) are declared here and loaded by hand.
+#ifndef GL_DEBUG_OUTPUT
+#define GL_DEBUG_OUTPUT_SYNCHRONOUS 0x8242
+#define GL_DEBUG_SOURCE_API 0x8246
+#define GL_DEBUG_SOURCE_WINDOW_SYSTEM 0x8247
+#define GL_DEBUG_SOURCE_SHADER_COMPILER 0x8248
+#define GL_DEBUG_SOURCE_THIRD_PARTY 0x8249
+#define GL_DEBUG_SOURCE_APPLICATION 0x824A
+#define GL_DEBUG_SOURCE_OTHER 0x824B
+#define GL_DEBUG_TYPE_ERROR 0x824C
+#define GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR 0x824D
+#define GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR 0x824E
+#define GL_DEBUG_TYPE_PORTABILITY 0x824F
+#define GL_DEBUG_TYPE_PERFORMANCE 0x8250
+#define GL_DEBUG_TYPE_OTHER 0x8251
+#define GL_DEBUG_TYPE_MARKER 0x8268
+#define GL_DEBUG_TYPE_PUSH_GROUP 0x8269
+#define GL_DEBUG_TYPE_POP_GROUP 0x826A
+#define GL_DEBUG_SEVERITY_HIGH 0x9146
+#define GL_DEBUG_SEVERITY_MEDIUM 0x9147
+#define GL_DEBUG_SEVERITY_LOW 0x9148
+#define GL_DEBUG_SEVERITY_NOTIFICATION 0x826B
+#define GL_DEBUG_OUTPUT 0x92E0
+#endif
+
+typedef void(APIENTRY *DebugMessageProc)(GLenum source, GLenum type,
+                                         GLuint id, GLenum severity,
+                                         GLsizei length,
+                                         const GLchar *message,
+                                         const void *userParam);
+typedef void(APIENTRYP DebugMessageCallbackProc)(DebugMessageProc callback,
+                                                  const void *userParam);
+
+struct DebugMessage {
+  GLenum source;
+  GLenum type;
+  GLuint id;
+  GLenum severity;
+  std::string text;
+  long count = 0;
+};
+
+struct DebugOutputState {
+  bool enabled = false;
+  std::vector<DebugMessage> messages;
+  long total = 0;
+};
+
+inline DebugOutputState &debugOutput() {
+  static DebugOutputState state;
+  return state;
+}
+
+inline const char *debugSourceName(GLenum source) {
+  switch (source) {
+  case GL_DEBUG_SOURCE_API:
+    return "api";
+  case GL_DEBUG_SOURCE_WINDOW_SYSTEM:
+    return "window system";
+  case GL_DEBUG_SOURCE_SHADER_COMPILER:
+    return "shader compiler";
+  case GL_DEBUG_SOURCE_THIRD_PARTY:
+    return "third party";
+  case GL_DEBUG_SOURCE_APPLICATION:
+    return "application";
+  default:
+    return "other";
+  }
+}
+
+inline const char *debugTypeName(GLenum type) {
+  switch (type) {
+  case GL_DEBUG_TYPE_ERROR:
+    return "error";
+  case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR:
+    return "deprecated";
+  case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:
+    return "undefined";
+  case GL_DEBUG_TYPE_PORTABILITY:
+    return "portability";
+  case GL_DEBUG_TYPE_PERFORMANCE:
+    return "performance";
+  case GL_DEBUG_TYPE_MARKER:
+    return "marker";
+  default:
+    return "other";
+  }
+}
+
+inline const char *debugSeverityName(GLenum severity) {
+  switch (severity) {
+  case GL_DEBUG_SEVERITY_HIGH:
+    return "high";
+  case GL_DEBUG_SEVERITY_MEDIUM:
+    return "medium";
+  case GL_DEBUG_SEVERITY_LOW:
+    return "low";
+  default:
+    return "info";
+  }
+}
+
+inline void APIENTRY recordDebugMessage(GLenum source, GLenum type, GLuint id,
+                                        GLenum severity, GLsizei length,
+                                        const GLchar *message,
+                                        const void *userParam) {
+  (void)userParam;
+  if (type == GL_DEBUG_TYPE_PUSH_GROUP || type == GL_DEBUG_TYPE_POP_GROUP)
+    return;
+
+  DebugOutputState &state = debugOutput();
+  state.total++;
+  std::string text = length < 0 ? std::string(message)
+                                 : std::string(message, (size_t)length);
+  while (!text.empty() && text[text.size() - 1] == '\n')
+    text.erase(text.size() - 1);
+  for (DebugMessage &entry : state.messages) {
+    if (entry.id == id && entry.source == source && entry.type == type &&
+        entry.text == text) {
+      entry.count++;
+      return;
+    }
+  }
+
+  DebugMessage entry;
+  entry.source = source;
+  entry.type = type;
+  entry.id = id;
+  entry.severity = severity;
+  entry.text = text;
+  entry.count = 1;
+  state.messages.push_back(entry);
+}
+
+// call after gladLoadGLLoader with the same loader; messages are delivered
+// synchronously so the callback never races the render loop. A debug context
+// (GLFW_OPENGL_DEBUG_CONTEXT, or createHeadlessContext(..., true)) makes
+// drivers report much more.
+inline bool enableDebugOutput(GLADloadproc load) {
+  // a loader may hand out a stub for any name, so ask the context first
+  GLint major = 0, minor = 0;
+  glGetIntegerv(GL_MAJOR_VERSION, &major);
+  glGetIntegerv(GL_MINOR_VERSION, &minor);
+  if ((major < 4 || (major == 4 && minor < 3)) &&
+      !hasExtension("GL_KHR_debug")) {
+    std::printf("GL_KHR_debug is not supported, --debug-output ignored\n");
+    return false;
+  }
+
+  DebugMessageCallbackProc debugMessageCallback =
+      (DebugMessageCallbackProc)load("glDebugMessageCallback");
+  if (debugMessageCallback == NULL)
+    debugMessageCallback =
+        (DebugMessageCallbackProc)load("glDebugMessageCallbackKHR");
+  if (debugMessageCallback == NULL) {
+    std::printf("GL_KHR_debug is not supported, --debug-output ignored\n");
+    return false;
+  }
+
+  glEnable(GL_DEBUG_OUTPUT);
+  glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+  debugMessageCallback(recordDebugMessage, NULL);
+  debugOutput().enabled = true;
+  return true;
+}
+
+inline void printDebugOutput() {
+  const DebugOutputState &state = debugOutput();
+  if (!state.enabled)
+    return;
+
+  std::vector<const DebugMessage *> ranked;
+  for (const DebugMessage &entry : state.messages)
+    ranked.push_back(&entry);
+  std::stable_sort(ranked.begin(), ranked.end(),
+                   [](const DebugMessage *a, const DebugMessage *b) {
+                     return a->count > b->count;
+                   });
+
+  std::printf("GL debug messages (%ld, %zu distinct):\n", state.total,
+              ranked.size());
+  for (const DebugMessage *entry : ranked)
+    std::printf("  %6ldx %-11s %-6s %s: %s\n", entry->count,
+                debugTypeName(entry->type), debugSeverityName(entry->severity),
+                debugSourceName(entry->source), entry->text.c_str());
+}
+
+#endif
@@ -0,0 +1,197 @@
+#ifndef INDEX_BUFFER_H
+#define INDEX_BUFFER_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// Index buffers in the narrowest type that holds their largest index:
+// GL_UNSIGNED_BYTE up to 255, GL_UNSIGNED_SHORT up to 65535, GL_UNSIGNED_INT
+// above. Meshes are written with GLuint indices and narrowed on upload.
+//
+// A list mesh with more vertices than a short can address is split into
+// chunks of whole primitives whose vertices span fewer than 65536 indices,
+// each stored relative to its first vertex and drawn with
+// glDrawElementsBaseVertex. That only pays off when the index order has
+// locality (every chunk then holds many primitives); a mesh that would need
+// a draw per few thousand indices keeps GL_UNSIGNED_INT.
+const size_t indexChunkMinimum = 16384; // average indices per chunk to split
+
+struct IndexChunk {
+  size_t first = 0; // index into the buffer
+  size_t count = 0;
+  GLint baseVertex = 0;
+};
+
+struct IndexBuffer {
+  GLuint buffer = 0;
+  GLenum type = GL_UNSIGNED_INT;
+  size_t count = 0;
+  std::vector<IndexChunk> chunks; // empty unless split
+};
+
+struct IndexBufferStats {
+  long buffers = 0;
+  long split = 0;
+  double bytes = 0.0;
+  double bytesAsUint = 0.0; // what the same indices take as GLuint
+};
+
+inline IndexBufferStats &indexBufferStats() {
+  static IndexBufferStats stats;
+  return stats;
+}
+
+inline GLenum indexTypeFor(GLuint maxIndex) {
+  if (maxIndex <= 0xFF)
+    return GL_UNSIGNED_BYTE;
+  if (maxIndex <= 0xFFFF)
+    return GL_UNSIGNED_SHORT;
+  return GL_UNSIGNED_INT;
+}
+
+inline size_t indexSize(GLenum type) {
+  return type == GL_UNSIGNED_BYTE ? 1 : type == GL_UNSIGNED_SHORT ? 2 : 4;
+}
+
+// the byte offset glDrawElements takes for the first index
+inline const void *indexOffset(const IndexBuffer &indices, size_t first) {
+  return (const void *)(uintptr_t)(first * indexSize(indices.type));
+}
+
+// Greedy split into chunks of whole primitives spanning < 65536 vertices.
+// Returns false when that would take more chunks than it is worth.
+inline bool splitIndices(const GLuint *indices, size_t count,
+                         size_t primitiveSize,
+                         std::vector<IndexChunk> &chunks) {
+  size_t maxChunks = std::max<size_t>(1, count / indexChunkMinimum);
+  IndexChunk chunk;
+  GLuint low = UINT32_MAX, high = 0;
+  for (size_t i = 0; i + primitiveSize <= count; i += primitiveSize) {
+    GLuint primitiveLow = UINT32_MAX, primitiveHigh = 0;
+    for (size_t j = i; j < i + primitiveSize; j++) {
+      primitiveLow = std::min(primitiveLow, indices[j]);
+      primitiveHigh = std::max(primitiveHigh, indices[j]);
+    }
+    GLuint nextLow = std::min(low, primitiveLow);
+    GLuint nextHigh = std::max(high, primitiveHigh);
+    if (chunk.count > 0 && nextHigh - nextLow > 0xFFFF) {
+      chunk.baseVertex = (GLint)low;
+      chunks.push_back(chunk);
+      if (chunks.size() >= maxChunks)
+        return false;
+      chunk.first = i;
+      chunk.count = 0;
+      nextLow = primitiveLow;
+      nextHigh = primitiveHigh;
+    }
+    if (primitiveHigh - primitiveLow > 0xFFFF)
+      return false; // one primitive alone is too wide
+    low = nextLow;
+    high = nextHigh;
+    chunk.count += primitiveSize;
+  }
+  chunk.baseVertex = (GLint)low;
+  chunks.push_back(chunk);
+  return true;
+}
+
+template <typename T>
+inline std::vector<T> narrowIndices(const GLuint *indices, size_t count,
+                                    const std::vector<IndexChunk> &chunks) {
+  std::vector<T> narrow(count);
+  if (chunks.empty()) {
+    for (size_t i = 0; i < count; i++)
+      narrow[i] = (T)indices[i];
+    return narrow;
+  }
+  for (const IndexChunk &chunk : chunks)
+    for (size_t i = chunk.first; i < chunk.first + chunk.count; i++)
+      narrow[i] = (T)(indices[i] - (GLuint)chunk.baseVertex);
+  return narrow;
+}
+
+// Uploads count indices to a new GL_ELEMENT_ARRAY_BUFFER, which also attaches
+// it to the bound vertex array. primitiveSize is the vertices per primitive
+// (3 for GL_TRIANGLES, 2 for GL_LINES); pass 0 for strips, fans and loops,
+// which cannot be split.
+inline IndexBuffer createIndexBuffer(const GLuint *indices, size_t count,
+                                     size_t primitiveSize = 3,
+                                     GLenum usage = GL_STATIC_DRAW) {
+  IndexBuffer buffer;
+  buffer.count = count;
+  GLuint maxIndex = 0;
+  for (size_t i = 0; i < count; i++)
+    maxIndex = std::max(maxIndex, indices[i]);
+  buffer.type = indexTypeFor(maxIndex);
+  if (buffer.type == GL_UNSIGNED_INT && primitiveSize > 0 &&
+      count % primitiveSize == 0) {
+    if (splitIndices(indices, count, primitiveSize, buffer.chunks))
+      buffer.type = GL_UNSIGNED_SHORT;
+    else
+      buffer.chunks.clear();
+  }
+
+  glGenBuffers(1, &buffer.buffer);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer.buffer);
+  GLsizeiptr bytes = (GLsizeiptr)(count * indexSize(buffer.type));
+  if (buffer.type == GL_UNSIGNED_BYTE)
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, bytes,
+                 narrowIndices<GLubyte>(indices, count, buffer.chunks).data(),
+                 usage);
+  else if (buffer.type == GL_UNSIGNED_SHORT)
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, bytes,
+                 narrowIndices<GLushort>(indices, count, buffer.chunks).data(),
+                 usage);
+  else
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, bytes, indices, usage);
+
+  IndexBufferStats &stats = indexBufferStats();
+  stats.buffers++;
+  stats.split += buffer.chunks.empty() ? 0 : 1;
+  stats.bytes += (double)bytes;
+  stats.bytesAsUint += (double)(count * sizeof(GLuint));
+  return buffer;
+}
+
+// indices [first, first + count) of an unsplit buffer, with the vertex array
+// that owns it bound
+inline void drawIndices(GLenum mode, const IndexBuffer &indices, size_t first,
+                        size_t count) {
+  glDrawElements(mode, (GLsizei)count, indices.type,
+                 indexOffset(indices, first));
+}
+
+// the whole buffer, one draw per chunk
+inline void drawIndexBuffer(GLenum mode, const IndexBuffer &indices) {
+  if (indices.chunks.empty()) {
+    drawIndices(mode, indices, 0, indices.count);
+    return;
+  }
+  for (const IndexChunk &chunk : indices.chunks)
+    glDrawElementsBaseVertex(mode, (GLsizei)chunk.count, indices.type,
+                             (void *)indexOffset(indices, chunk.first),
+                             chunk.baseVertex);
+}
+
+inline void deleteIndexBuffer(IndexBuffer &indices) {
+  glDeleteBuffers(1, &indices.buffer);
+  indices = IndexBuffer();
+}
+
+inline void printIndexBufferStats() {
+  const IndexBufferStats &stats = indexBufferStats();
+  if (stats.buffers == 0)
+    return;
+  std::printf("index buffers: %ld, %.0f bytes (%.0f as GLuint, %.1fx smaller)",
+              stats.buffers, stats.bytes, stats.bytesAsUint,
+              stats.bytesAsUint / std::max(stats.bytes, 1.0));
+  if (stats.split > 0)
+    std::printf(", %ld split into 16-bit chunks", stats.split);
+  std::printf("\n");
+}
+
+#endif
@@ -5,101 +5,90 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <cmath>
 #include <iostream>
 
-const GLchar* vertexShaderSource =
-"#version 330 core\n"
-"layout(location = 0) in vec3 position;\n"
-"layout(location = 1) in vec3 color;\n"
-"out vec3 vertexColor;\n"
-"uniform mat4 model;\n"
-"void main()\n"
-"{\n"
-"    gl_Position = model * vec4(position.x, position.y, position.z, 1.0);\n"
-"    vertexColor = color;\n"
-"}\0";
-
-const GLchar* fragmentShaderSource =
-"#version 330 core\n"
-"in vec3 vertexColor;\n"
-"out vec4 fragmentColor;\n"
-"void main()\n"
-"{\n"
-"    fragmentColor = vec4(vertexColor, 1.0);\n"
-"}\0";
-
-
-int main()
-{
-    // inicjalizacja GLFW
-    glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#include "bench.h"
+#include "clock.h"
+#include "cpu_trace.h"
+#include "headless.h"
+#include "index_buffer.h"
+#include "shader.h"
+#include "shader_files.h"
+
 
+int main(int argc, char** argv)
+{
+    StartupProfile startup;
+    RunOptions options = parseRunOptions(argc, argv);
 
-    // Tworzenie okna
     const unsigned int window_width = 1000;
     const unsigned int window_height = 800;
-    GLFWwindow* window = glfwCreateWindow(window_width, window_height, "grafika komputerowa", NULL, NULL);
-    if (window == NULL)
+    GLFWwindow* window = NULL;
+    HeadlessContext headless;
+
+    if (options.headless)
     {
-        std::cout << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
-        return -1;
+        if (!createHeadlessContext(headless, window_width, window_height, options.debugOutput))
+            return -1;
+        markStartupPhase(startup, "egl context");
+    }
+    else
+    {
+        // inicjalizacja GLFW
+        glfwInit();
+        markStartupPhase(startup, "glfwInit");
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, options.debugOutput ? GLFW_TRUE : GLFW_FALSE);
+
+
+        // Tworzenie okna
+        window = glfwCreateWindow(window_width, window_height, "grafika komputerowa", NULL, NULL);
+        if (window == NULL)
+        {
+            std::cout << "Failed to create GLFW window" << std::endl;
+            glfwTerminate();
+            return -1;
+        }
+        glfwMakeContextCurrent(window);
+        markStartupPhase(startup, "window");
     }
-    glfwMakeContextCurrent(window);
 
 
     // inicjalizacja GLAD
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    GLADloadproc loader = options.headless ? (GLADloadproc)headlessGetProcAddress : (GLADloadproc)glfwGetProcAddress;
+    if (!gladLoadGLLoader(loader))
     {
         std::cout << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
 
+    if (options.glCounters)
+        installGlCounters();
+    if (options.debugOutput)
+        enableDebugOutput(loader);
+    initParallelShaderCompile(loader);
+    if (options.shaderCache != NULL)
+        initShaderCache(options.shaderCache, loader);
+    if (options.spirv != NULL || options.dumpShaders != NULL)
+        initSpirvShaders(options.spirv, options.dumpShaders, loader);
+    if (options.hotReload)
+        initShaderHotReload();
+
+    if (options.headless && !createHeadlessFramebuffer(headless, window_width, window_height))
+        return -1;
+    if (options.overdraw)
+        enableOverdraw();
+    markStartupPhase(startup, "glad");
 
-    // shadery
-    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glCompileShader(vertexShader);
-
-    GLint status;
-    GLchar error_message[512];
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &status);
-    if (!status)
-    {
-        glGetShaderInfoLog(vertexShader, 512, NULL, error_message);
-        std::cout << "Error (Vertex shader): " << error_message << std::endl;
-    }
-
-    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
-
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &status);
-    if (!status)
-    {
-        glGetShaderInfoLog(fragmentShader, 512, NULL, error_message);
-        std::cout << "Error (Fragment shader): " << error_message << std::endl;
-    }
-
-    GLuint shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
 
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &status);
-    if (!status)
-    {
-        glGetProgramInfoLog(shaderProgram, 512, NULL, error_message);
-        std::cout << "Error (Shader program): " << error_message << std::endl;
-    }
-
-    glDetachShader(shaderProgram, vertexShader);
-    glDetachShader(shaderProgram, fragmentShader);
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    // shadery
+    ShaderVariants shapeShader = shaderVariants(loadShaderFile("shape.vert"), loadShaderFile("shape.frag"));
+    watchShaderVariants(shapeShader, "shape.vert", "shape.frag");
+    submitShaderVariant(shapeShader, 0);
+    markStartupPhase(startup, "shaders");
 
 
     // vertex data
@@ -133,16 +122,14 @@ int main()
     GLuint VBO[2];
     glGenBuffers(2, VBO);
     
-    GLuint EBO[2];
-    glGenBuffers(2, EBO);
+    IndexBuffer EBO[2];
 
     glBindVertexArray(VAO[0]);
 
     glBindBuffer(GL_ARRAY_BUFFER, VBO[0]);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO[0]);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    EBO[0] = createIndexBuffer(indices, sizeof(indices) / sizeof(indices[0]));
 
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (void*)0);
     glEnableVertexAttribArray(0);
@@ -157,8 +144,7 @@ int main()
     glBindBuffer(GL_ARRAY_BUFFER, VBO[1]);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices2), vertices2, GL_STATIC_DRAW);
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO[1]);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices2), indices2, GL_STATIC_DRAW);
+    EBO[1] = createIndexBuffer(indices2, sizeof(indices2) / sizeof(indices2[0]));
 
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (void*)0);
     glEnableVertexAttribArray(0);
@@ -168,54 +154,128 @@ int main()
 
     glBindVertexArray(0);
 
-    // uniforms
-    GLint modelLoc = glGetUniformLocation(shaderProgram, "model");
+    shaderVariant(shapeShader, 0);
+
+    // uniforms, looked up for each program (again after --hot-reload replaced it)
+    unsigned shaderGeneration = ~0u;
+    GLint modelLoc = -1;
 
     glViewport(0, 0, (GLuint)window_width, (GLuint)window_height);
 
+    FrameStats frameStats;
+    initFrameStats(frameStats);
+
+    GpuProfiler gpuProfiler;
+    gpuProfiler.enabled = options.gpuProfile || options.bench != NULL;
+
+    Clock clock;
+    if (!initClock(clock, options.clock, window))
+        return -1;
+
+    // --scale N draws N copies of the scene in a grid
+    const long shapeCount = options.scale > 0 ? options.scale : 1;
+    const int grid = (int)std::ceil(std::sqrt((double)shapeCount));
+
+    CpuTrace cpuTrace;
+    initCpuTrace(cpuTrace, options.trace != NULL);
+
+    markStartupPhase(startup, "scene");
+    double cpuStart = processCpuTime();
+    double previousTime = runTime(window);
+
     // pętla zdarzeń
-    while (!glfwWindowShouldClose(window))
+    long frame = 0;
+    while (keepRunning(window, options, frame))
     {
+        pushCpuScope(cpuTrace, "frame");
+        pollShaderFiles();
+
+        beginGpuFrame(gpuProfiler);
+        pushGpuScope(gpuProfiler, "frame");
+
         // renderowanie
+        pushGpuScope(gpuProfiler, "clear");
         glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
+        popGpuScope(gpuProfiler);
 
-        double timeValue = glfwGetTime();
+        tickClock(clock);
+        double timeValue = clock.time;
 
         // rysowanie
-        glUseProgram(shaderProgram);
-
+        pushGpuScope(gpuProfiler, "shapes");
+        const ShaderVariant& shader = shaderVariant(shapeShader, 0);
+        if (shader.generation != shaderGeneration)
+        {
+            modelLoc = uniformLocation(shader.uniforms, "model", GL_FLOAT_MAT4);
+            shaderGeneration = shader.generation;
+        }
+        glUseProgram(shader.program);
+
+        pushCpuScope(cpuTrace, "matrices");
         glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -0.25f * std::sin(timeValue), 0.0f));
         glm::mat4 model2 = glm::rotate(glm::mat4(1.0f), glm::radians(float(timeValue) * glm::pi<float>()), glm::vec3(0.0f, 0.0f, 1.0f));
         glm::mat4 model3 = glm::scale(glm::mat4(1.0f), glm::vec3(0.5f * std::abs(std::sin(timeValue)), 0.5f * std::abs(std::sin(timeValue)), 0.5f));
         glm::mat4 model4 = model * model3 * model2;
+        popCpuScope(cpuTrace);
+
+        // the uniforms differ per draw, so they are part of the submission
+        pushCpuScope(cpuTrace, "draw");
 
-        glBindVertexArray(VAO[0]);
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(glm::translate(glm::mat4(1.0f), glm::vec3(-0.5f, 0.5f, 0.0f)) * model));
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+        for (long i = 0; i < shapeCount; i++)
+        {
+            glm::mat4 cell = glm::translate(glm::mat4(1.0f), glm::vec3((2.0f * (i % grid) + 1.0f) / grid - 1.0f, 1.0f - (2.0f * (i / grid) + 1.0f) / grid, 0.0f));
+            cell = glm::scale(cell, glm::vec3(1.0f / grid, 1.0f / grid, 1.0f));
 
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(glm::translate(glm::mat4(1.0f), glm::vec3(0.5f, -0.5f, 0.0f)) * model2));
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+            glBindVertexArray(VAO[0]);
+            glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(cell * glm::translate(glm::mat4(1.0f), glm::vec3(-0.5f, 0.5f, 0.0f)) * model));
+            drawIndexBuffer(GL_TRIANGLES, EBO[0]);
 
-        glBindVertexArray(VAO[1]);
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(glm::translate(glm::mat4(1.0f), glm::vec3(-0.5f, -0.5f, 0.0f)) * model3));
-        glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_INT, 0);
+            glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(cell * glm::translate(glm::mat4(1.0f), glm::vec3(0.5f, -0.5f, 0.0f)) * model2));
+            drawIndexBuffer(GL_TRIANGLES, EBO[0]);
 
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(glm::translate(glm::mat4(1.0f), glm::vec3(0.5f, 0.5f, 0.0f)) * model4));
-        glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_INT, 0);
+            glBindVertexArray(VAO[1]);
+            glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(cell * glm::translate(glm::mat4(1.0f), glm::vec3(-0.5f, -0.5f, 0.0f)) * model3));
+            drawIndexBuffer(GL_TRIANGLES, EBO[1]);
+
+            glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(cell * glm::translate(glm::mat4(1.0f), glm::vec3(0.5f, 0.5f, 0.0f)) * model4));
+            drawIndexBuffer(GL_TRIANGLES, EBO[1]);
+        }
 
         glBindVertexArray(0);
+        popCpuScope(cpuTrace);
+        popGpuScope(gpuProfiler);
+
+        popGpuScope(gpuProfiler);
+        endGpuFrame(gpuProfiler);
+        endGlCounterFrame();
 
         //
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        presentTracedFrame(window, cpuTrace);
+        if (frame == 0)
+            markFirstFrame(startup);
+        popCpuScope(cpuTrace);
+
+        double currentTime = runTime(window);
+        recordFrame(frameStats, currentTime - previousTime);
+        previousTime = currentTime;
+        frame++;
     }
 
+    bool passed = reportRun(options, "l6", shapeCount, frameStats, gpuProfiler, startup, processCpuTime() - cpuStart);
+    destroyGpuProfiler(gpuProfiler);
+    if (options.trace != NULL)
+        writeCpuTrace(cpuTrace, options.trace);
+
     glDeleteVertexArrays(2, VAO);
     glDeleteBuffers(2, VBO);
-    glDeleteBuffers(2, EBO);
-    glDeleteProgram(shaderProgram);
+    deleteIndexBuffer(EBO[0]);
+    deleteIndexBuffer(EBO[1]);
+    deleteShaderVariants(shapeShader);
 
-    glfwTerminate();
-    return 0;
+    if (options.headless)
+        destroyHeadlessContext(headless);
+    else
+        glfwTerminate();
+    return passed ? 0 : 1;
 }
\ No newline at end of file
@@ -0,0 +1,253 @@
+#ifndef VERTEX_FORMAT_H
+#define VERTEX_FORMAT_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <initializer_list>
+#include <iostream>
+#include <vector>
+
+// Packed vertex formats. Meshes are still written as floats; a VertexFormat
+// says how each attribute is stored in the vertex buffer, and packVertices
+// converts on upload:
+//
+//   VERTEX_FLOAT    32-bit float
+//   VERTEX_HALF     16-bit float, any range (3 significant digits)
+//   VERTEX_SNORM16  -1..1 in 16 bits, for positions inside the unit cube
+//   VERTEX_UNORM16  0..1 in 16 bits, for UVs that do not repeat
+//   VERTEX_UNORM8   0..1 in 8 bits, for colors
+//
+// The normalized types are read back as floats by glVertexAttribPointer
+// (normalized = GL_TRUE), so shaders keep their vec2/vec3 inputs. Every
+// attribute starts on 4 bytes: a 3-component snorm16 position takes 8
+// bytes and a UNORM8 color is always an unorm8x4 slot.
+enum VertexComponent {
+  VERTEX_FLOAT,
+  VERTEX_HALF,
+  VERTEX_SNORM16,
+  VERTEX_UNORM16,
+  VERTEX_UNORM8
+};
+
+struct VertexAttribute {
+  GLuint location;
+  GLint components; // floats per vertex in the source
+  VertexComponent component;
+};
+
+struct VertexFormat {
+  std::vector<VertexAttribute> attributes;
+  std::vector<size_t> offsets; // bytes into a packed vertex
+  GLsizei stride = 0;          // bytes per packed vertex
+  size_t sourceStride = 0;     // floats per source vertex
+};
+
+struct VertexBufferStats {
+  long buffers = 0;
+  double bytes = 0.0;
+  double bytesAsFloat = 0.0; // what the same vertices take as floats
+  long weldedFrom = 0;        // vertices before and after weldVertices
+  long weldedTo = 0;
+};
+
+inline VertexBufferStats &vertexBufferStats() {
+  static VertexBufferStats stats;
+  return stats;
+}
+
+inline size_t vertexComponentSize(VertexComponent component) {
+  switch (component) {
+  case VERTEX_FLOAT:
+    return 4;
+  case VERTEX_HALF:
+  case VERTEX_SNORM16:
+  case VERTEX_UNORM16:
+    return 2;
+  default:
+    return 1;
+  }
+}
+
+inline GLenum vertexComponentType(VertexComponent component) {
+  switch (component) {
+  case VERTEX_FLOAT:
+    return GL_FLOAT;
+  case VERTEX_HALF:
+    return GL_HALF_FLOAT;
+  case VERTEX_SNORM16:
+    return GL_SHORT;
+  case VERTEX_UNORM16:
+    return GL_UNSIGNED_SHORT;
+  default:
+    return GL_UNSIGNED_BYTE;
+  }
+}
+
+inline bool vertexComponentNormalized(VertexComponent component) {
+  return component == VERTEX_SNORM16 || component == VERTEX_UNORM16 ||
+         component == VERTEX_UNORM8;
+}
+
+// source attributes are laid out back to back in the order given
+inline VertexFormat
+vertexFormat(std::initializer_list<VertexAttribute> attributes) {
+  VertexFormat format;
+  size_t offset = 0;
+  for (const VertexAttribute &attribute : attributes) {
+    format.attributes.push_back(attribute);
+    format.offsets.push_back(offset);
+    size_t size =
+        attribute.components * vertexComponentSize(attribute.component);
+    offset += (size + 3) / 4 * 4;
+    format.sourceStride += attribute.components;
+  }
+  format.stride = (GLsizei)offset;
+  return format;
+}
+
+// round to nearest even; overflow becomes infinity
+inline GLushort floatToHalf(float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  uint32_t sign = (bits >> 16) & 0x8000;
+  int exponent = (int)((bits >> 23) & 0xFF);
+  uint32_t mantissa = bits & 0x7FFFFF;
+  if (exponent == 0xFF) // infinity, NaN
+    return (GLushort)(sign | 0x7C00 | (mantissa != 0 ? 0x200 : 0));
+
+  int halfExponent = exponent - 127 + 15;
+  if (halfExponent >= 0x1F)
+    return (GLushort)(sign | 0x7C00);
+  int shift = 13;
+  uint32_t half;
+  if (halfExponent <= 0) { // subnormal half
+    if (halfExponent < -10)
+      return (GLushort)sign;
+    mantissa |= 0x800000;
+    shift = 14 - halfExponent;
+    half = mantissa >> shift;
+  } else {
+    half = ((uint32_t)halfExponent << 10) | (mantissa >> shift);
+  }
+  uint32_t rest = mantissa & ((1u << shift) - 1);
+  uint32_t halfway = 1u << (shift - 1);
+  if (rest > halfway || (rest == halfway && (half & 1)))
+    half++; // may carry into the exponent, which is still correct
+  return (GLushort)(sign | half);
+}
+
+// Converts vertexCount source vertices (format.sourceStride floats each).
+// Values outside the range of a normalized type are clamped and counted in
+// clamped.
+inline std::vector<unsigned char> packVertices(const VertexFormat &format,
+                                               const GLfloat *vertices,
+                                               size_t vertexCount,
+                                               size_t &clamped) {
+  std::vector<unsigned char> packed(vertexCount * format.stride, 0);
+  clamped = 0;
+  for (size_t v = 0; v < vertexCount; v++) {
+    const GLfloat *source = vertices + v * format.sourceStride;
+    unsigned char *vertex = &packed[v * format.stride];
+    for (size_t a = 0; a < format.attributes.size(); a++) {
+      const VertexAttribute &attribute = format.attributes[a];
+      unsigned char *out = vertex + format.offsets[a];
+      for (GLint c = 0; c < attribute.components; c++) {
+        float value = *source++;
+        float low = attribute.component == VERTEX_SNORM16 ? -1.0f : 0.0f;
+        if (vertexComponentNormalized(attribute.component) &&
+            (value < low || value > 1.0f)) {
+          value = std::min(std::max(value, low), 1.0f);
+          clamped++;
+        }
+        switch (attribute.component) {
+        case VERTEX_FLOAT:
+          std::memcpy(out + 4 * c, &value, 4);
+          break;
+        case VERTEX_HALF: {
+          GLushort half = floatToHalf(value);
+          std::memcpy(out + 2 * c, &half, 2);
+          break;
+        }
+        case VERTEX_SNORM16: {
+          GLshort snorm = (GLshort)std::lround(value * 32767.0f);
+          std::memcpy(out + 2 * c, &snorm, 2);
+          break;
+        }
+        case VERTEX_UNORM16: {
+          GLushort unorm = (GLushort)std::lround(value * 65535.0f);
+          std::memcpy(out + 2 * c, &unorm, 2);
+          break;
+        }
+        case VERTEX_UNORM8:
+          out[c] = (unsigned char)std::lround(value * 255.0f);
+          break;
+        }
+      }
+    }
+  }
+  return packed;
+}
+
+// glVertexAttribPointer and enable for every attribute, reading the buffer
+// bound to GL_ARRAY_BUFFER
+inline void setVertexAttributes(const VertexFormat &format) {
+  for (size_t a = 0; a < format.attributes.size(); a++) {
+    const VertexAttribute &attribute = format.attributes[a];
+    glVertexAttribPointer(
+        attribute.location, attribute.components,
+        vertexComponentType(attribute.component),
+        vertexComponentNormalized(attribute.component) ? GL_TRUE : GL_FALSE,
+        format.stride, (void *)(uintptr_t)format.offsets[a]);
+    glEnableVertexAttribArray(attribute.location);
+  }
+}
+
+// Packs and uploads the vertices to a new GL_ARRAY_BUFFER and points the
+// bound vertex array's attributes at it. name labels the clamping warning.
+inline GLuint createVertexBuffer(const VertexFormat &format,
+                                 const GLfloat *vertices, size_t vertexCount,
+                                 const char *name = "Vertex buffer",
+                                 GLenum usage = GL_STATIC_DRAW) {
+  size_t clamped = 0;
+  std::vector<unsigned char> packed =
+      packVertices(format, vertices, vertexCount, clamped);
+  if (clamped > 0)
+    std::cout << "Warning (" << name << "): " << clamped
+              << " values out of range of their vertex format were clamped"
+              << std::endl;
+
+  GLuint buffer;
+  glGenBuffers(1, &buffer);
+  glBindBuffer(GL_ARRAY_BUFFER, buffer);
+  glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)packed.size(), packed.data(),
+               usage);
+  setVertexAttributes(format);
+
+  VertexBufferStats &stats = vertexBufferStats();
+  stats.buffers++;
+  stats.bytes += (double)packed.size();
+  stats.bytesAsFloat +=
+      (double)(vertexCount * format.sourceStride * sizeof(GLfloat));
+  return buffer;
+}
+
+inline void printVertexBufferStats() {
+  const VertexBufferStats &stats = vertexBufferStats();
+  if (stats.buffers == 0)
+    return;
+  std::printf("vertex buffers: %ld, %.0f bytes (%.0f as floats, %.1fx "
+              "smaller)",
+              stats.buffers, stats.bytes, stats.bytesAsFloat,
+              stats.bytesAsFloat / std::max(stats.bytes, 1.0));
+  if (stats.weldedFrom > 0)
+    std::printf(", %ld vertices welded to %ld", stats.weldedFrom,
+                stats.weldedTo);
+  std::printf("\n");
+}
+
+#endif
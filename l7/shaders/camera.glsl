@@ -0,0 +1,7 @@
+// per-frame camera data, one uniform buffer shared by every program
+// (CameraBlock in camera_block.h must match)
+layout(std140) uniform Camera
+{
+    mat4 view;
+    mat4 projection;
+};
@@ -0,0 +1,6 @@
+#version 330 core
+out vec4 fragmentColor;
+void main()
+{
+    fragmentColor = vec4(0.5, 0.3, 0.7, 1.0);
+}
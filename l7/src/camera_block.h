@@ -0,0 +1,50 @@
+#ifndef CAMERA_BLOCK_H
+#define CAMERA_BLOCK_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+#include "parameter_block.h"
+
+// Per-frame camera data in one std140 uniform buffer. Every program includes
+// shaders/camera.glsl and is pointed at cameraBlockBinding once after
+// linking, so a frame costs at most one buffer update however many programs
+// draw, and none while the camera stands still. GLSL 3.30 has no
+// layout(binding = N), hence bindCameraBlock.
+
+const GLuint cameraBlockBinding = 0;
+
+// std140 stores a mat4 as four vec4 columns, the same as glm
+struct CameraBlock {
+  glm::mat4 view;
+  glm::mat4 projection;
+};
+static_assert(sizeof(CameraBlock) == 128, "CameraBlock must match std140");
+
+// allocates the buffer and attaches it to cameraBlockBinding
+inline ParameterBlock createCameraBuffer() {
+  ParameterBlock buffer = createParameterBlock(sizeof(CameraBlock));
+  bindParameterBlock(buffer, 0, cameraBlockBinding);
+  return buffer;
+}
+
+// call once per linked program; reports programs without the block or with
+// a layout that does not match CameraBlock
+inline bool bindCameraBlock(GLuint program,
+                            const char *name = "Shader program") {
+  return bindUniformBlock(program, "Camera", cameraBlockBinding,
+                          sizeof(CameraBlock), name);
+}
+
+// the camera upload of a frame; each matrix is only sent when it changed
+inline void updateCameraBuffer(ParameterBlock &buffer,
+                               const CameraBlock &camera) {
+  setParameter(buffer, 0, offsetof(CameraBlock, view), camera.view);
+  setParameter(buffer, 0, offsetof(CameraBlock, projection),
+               camera.projection);
+}
+
+#endif
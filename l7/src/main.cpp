@@ -6,25 +6,17 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include <iostream>
+#include <vector>
 
-const GLchar *vertexShaderSource =
-    "#version 330 core\n"
-    "layout(location = 0) in vec3 position;\n"
-    "uniform mat4 model;\n"
-    "uniform mat4 view;\n"
-    "uniform mat4 projection;\n"
-    "void main()\n"
-    "{\n"
-    "    gl_Position = projection * view * model * vec4(position, 1.0);\n"
-    "}\0";
-
-const GLchar *fragmentShaderSource =
-    "#version 330 core\n"
-    "out vec4 fragmentColor;\n"
-    "void main()\n"
-    "{\n"
-    "    fragmentColor = vec4(0.5, 0.3, 0.7, 1.0);\n"
-    "}\0";
+#include "bench.h"
+#include "camera_block.h"
+#include "cpu_trace.h"
+#include "headless.h"
+#include "index_buffer.h"
+#include "mesh_optimize.h"
+#include "pipeline.h"
+#include "shader.h"
+#include "shader_files.h"
 
 
 const unsigned int window_width = 1000;
@@ -74,69 +66,87 @@ void mouseCallback(GLFWwindow* window, double xpos, double ypos) {
   cameraFront = glm::normalize(cameraFront_new);
 }
 
-int main() {
-  // inicjalizacja GLFW
-  glfwInit();
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-  // Tworzenie okna
-  GLFWwindow *window = glfwCreateWindow(window_width, window_height,
-                                        "grafika komputerowa", NULL, NULL);
-  if (window == NULL) {
-    std::cout << "Failed to create GLFW window" << std::endl;
-    glfwTerminate();
-    return -1;
+// --scale N: N cubes in a grid behind the first one; cube 0 stays in place
+glm::vec3 cubeOffset(long index, long count) {
+  long grid = 1;
+  while (grid * grid * grid < count)
+    grid++;
+  float center = (grid - 1) / 2.0f;
+  return glm::vec3(3.0f * (index % grid - center),
+                   3.0f * ((index / grid) % grid - center),
+                   -3.0f * (index / (grid * grid)));
+}
+
+int main(int argc, char **argv) {
+  StartupProfile startup;
+  RunOptions options = parseRunOptions(argc, argv);
+
+  GLFWwindow *window = NULL;
+  HeadlessContext headless;
+
+  if (options.headless) {
+    if (!createHeadlessContext(headless, window_width, window_height,
+                               options.debugOutput))
+      return -1;
+    markStartupPhase(startup, "egl context");
+  } else {
+    // inicjalizacja GLFW
+    glfwInit();
+    markStartupPhase(startup, "glfwInit");
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT,
+                   options.debugOutput ? GLFW_TRUE : GLFW_FALSE);
+
+    // Tworzenie okna
+    window = glfwCreateWindow(window_width, window_height,
+                              "grafika komputerowa", NULL, NULL);
+    if (window == NULL) {
+      std::cout << "Failed to create GLFW window" << std::endl;
+      glfwTerminate();
+      return -1;
+    }
+    glfwMakeContextCurrent(window);
+    markStartupPhase(startup, "window");
   }
-  glfwMakeContextCurrent(window);
 
   // inicjalizacja GLAD
-  if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+  GLADloadproc loader = options.headless ? (GLADloadproc)headlessGetProcAddress
+                                         : (GLADloadproc)glfwGetProcAddress;
+  if (!gladLoadGLLoader(loader)) {
     std::cout << "Failed to initialize GLAD" << std::endl;
     return -1;
   }
-  
-  glEnable(GL_DEPTH_TEST);
-
-  // shadery
-  GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-  glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-  glCompileShader(vertexShader);
-
-  GLint status;
-  GLchar error_message[512];
-  glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &status);
-  if (!status) {
-    glGetShaderInfoLog(vertexShader, 512, NULL, error_message);
-    std::cout << "Error (Vertex shader): " << error_message << std::endl;
-  }
-
-  GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-  glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-  glCompileShader(fragmentShader);
 
-  glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &status);
-  if (!status) {
-    glGetShaderInfoLog(fragmentShader, 512, NULL, error_message);
-    std::cout << "Error (Fragment shader): " << error_message << std::endl;
-  }
-
-  GLuint shaderProgram = glCreateProgram();
-  glAttachShader(shaderProgram, vertexShader);
-  glAttachShader(shaderProgram, fragmentShader);
-  glLinkProgram(shaderProgram);
+  if (options.glCounters)
+    installGlCounters();
+  if (options.debugOutput)
+    enableDebugOutput(loader);
+  initParallelShaderCompile(loader);
+  if (options.shaderCache != NULL)
+    initShaderCache(options.shaderCache, loader);
+  if (options.spirv != NULL || options.dumpShaders != NULL)
+    initSpirvShaders(options.spirv, options.dumpShaders, loader);
+  if (options.hotReload)
+    initShaderHotReload();
+
+  if (options.headless &&
+      !createHeadlessFramebuffer(headless, window_width, window_height))
+    return -1;
+  if (options.overdraw)
+    enableOverdraw();
+  markStartupPhase(startup, "glad");
 
-  glGetProgramiv(shaderProgram, GL_LINK_STATUS, &status);
-  if (!status) {
-    glGetProgramInfoLog(shaderProgram, 512, NULL, error_message);
-    std::cout << "Error (Shader program): " << error_message << std::endl;
-  }
+  // shadery
+  ShaderVariants cubeShader = shaderVariants(loadShaderFile("cube.vert"),
+                                             loadShaderFile("cube.frag"));
+  watchShaderVariants(cubeShader, "cube.vert", "cube.frag");
+  submitShaderVariant(cubeShader, 0);
+  markStartupPhase(startup, "shaders");
 
-  glDetachShader(shaderProgram, vertexShader);
-  glDetachShader(shaderProgram, fragmentShader);
-  glDeleteShader(vertexShader);
-  glDeleteShader(fragmentShader);
+  glm::mat4 model = glm::mat4(1.0f);
+  model = glm::rotate(model, glm::radians(-45.0f), glm::vec3(1.0f, 0.0f, 0.0f));
 
   GLfloat vertices[] = {
     // front
@@ -173,6 +183,15 @@ int main() {
     6, 7, 3
   };
 
+  std::vector<GLfloat> cubeVertices(std::begin(vertices), std::end(vertices));
+  std::vector<GLuint> cubeIndices(std::begin(indices), std::end(indices));
+  if (options.optimizeMeshes) {
+    // front to back as seen from the start position, in cube coordinates
+    glm::vec3 viewDirection = glm::inverse(glm::mat3(model)) * cameraFront;
+    optimizeMesh(cubeVertices, 3, cubeIndices, glm::value_ptr(viewDirection),
+                 "cube");
+  }
+
   GLuint VAO;
   glGenVertexArrays(1, &VAO);
   glBindVertexArray(VAO);
@@ -180,13 +199,10 @@ int main() {
   GLuint VBO;
   glGenBuffers(1, &VBO);
   glBindBuffer(GL_ARRAY_BUFFER, VBO);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+  glBufferData(GL_ARRAY_BUFFER, cubeVertices.size() * sizeof(GLfloat),
+               cubeVertices.data(), GL_STATIC_DRAW);
 
-  GLuint EBO;
-  glGenBuffers(1, &EBO);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices,
-               GL_STATIC_DRAW);
+  IndexBuffer EBO = createIndexBuffer(cubeIndices.data(), cubeIndices.size());
 
   glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat),
                         (void *)0);
@@ -194,61 +210,132 @@ int main() {
 
   glBindVertexArray(0);
 
+  PipelineState cubeState;
+  cubeState.shader = &cubeShader;
+  cubeState.vertexArray = VAO;
+  cubeState.depthTest = true;
+  Pipeline cubePipeline = bakePipeline(cubeState);
+
   glViewport(0, 0, (GLuint)window_width, (GLuint)window_height);
 
-  glm::mat4 model = glm::mat4(1.0f);
-  model = glm::rotate(model, glm::radians(-45.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+  shaderVariant(cubeShader, 0);
+  // set up for each program, again after --hot-reload replaced it
+  unsigned shaderGeneration = ~0u;
+  GLint modelLoc = -1;
+
+  ParameterBlock cameraBuffer = createCameraBuffer();
+  CameraBlock camera;
+  camera.projection = glm::perspective(glm::radians(45.0f), static_cast<float>(window_width)/static_cast<float>(window_height), 0.1f, 100.0f);
 
-  GLint viewLoc = glGetUniformLocation(shaderProgram, "view");
 
-  GLint modelLoc = glGetUniformLocation(shaderProgram, "model");
-  glUseProgram(shaderProgram);
-  glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+  if (window != NULL) {
+    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    glfwSetCursorPosCallback(window, mouseCallback);
+  }
+
+  FrameStats frameStats;
+  initFrameStats(frameStats);
 
-  glm::mat4 projection = glm::perspective(glm::radians(45.0f), static_cast<float>(window_width)/static_cast<float>(window_height), 0.1f, 100.0f);
+  GpuProfiler gpuProfiler;
+  gpuProfiler.enabled = options.gpuProfile || options.bench != NULL;
 
-  GLint projectionLoc = glGetUniformLocation(shaderProgram, "projection");
-  glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
+  CpuTrace cpuTrace;
+  initCpuTrace(cpuTrace, options.trace != NULL);
 
+  const long cubeCount = options.scale > 0 ? options.scale : 1;
+  std::vector<glm::mat4> cubeModels(cubeCount);
 
-  glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-  glfwSetCursorPosCallback(window, mouseCallback);
+  markStartupPhase(startup, "scene");
+  double cpuStart = processCpuTime();
+  double previousTime = runTime(window);
 
   // pętla zdarzeń
-  while (!glfwWindowShouldClose(window)) {
+  long frame = 0;
+  while (keepRunning(window, options, frame)) {
+    pushCpuScope(cpuTrace, "frame");
+    pollShaderFiles();
+
+    pushCpuScope(cpuTrace, "input");
     const float cameraSpeed = 0.03f;
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-      cameraPosition += cameraSpeed * cameraFront;
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-      cameraPosition -= cameraSpeed * cameraFront;
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-      cameraPosition -= glm::normalize(glm::cross(cameraFront, cameraUp)) * cameraSpeed;
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-      cameraPosition += glm::normalize(glm::cross(cameraFront, cameraUp)) * cameraSpeed;
+    if (window != NULL) {
+      if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+        cameraPosition += cameraSpeed * cameraFront;
+      if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+        cameraPosition -= cameraSpeed * cameraFront;
+      if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+        cameraPosition -= glm::normalize(glm::cross(cameraFront, cameraUp)) * cameraSpeed;
+      if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+        cameraPosition += glm::normalize(glm::cross(cameraFront, cameraUp)) * cameraSpeed;
+    }
+    popCpuScope(cpuTrace);
 
     // renderowanie
+    beginGpuFrame(gpuProfiler);
+    pushGpuScope(gpuProfiler, "frame");
+
+    pushGpuScope(gpuProfiler, "clear");
     glClearColor(0.066f, 0.09f, 0.07f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-    glUseProgram(shaderProgram);
-
-    glm::mat4 view = glm::lookAt(cameraPosition, cameraPosition + cameraFront, cameraUp);
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+    popGpuScope(gpuProfiler);
+
+    pushGpuScope(gpuProfiler, "cube");
+    const ShaderVariant &shader = applyPipeline(cubePipeline);
+    if (shader.generation != shaderGeneration) {
+      bindCameraBlock(shader.program);
+      modelLoc = uniformLocation(shader.uniforms, "model", GL_FLOAT_MAT4);
+      shaderGeneration = shader.generation;
+    }
+
+    pushCpuScope(cpuTrace, "matrices");
+    camera.view = glm::lookAt(cameraPosition, cameraPosition + cameraFront, cameraUp);
+    for (long i = 0; i < cubeCount; i++)
+      cubeModels[i] = glm::translate(glm::mat4(1.0f), cubeOffset(i, cubeCount)) * model;
+    popCpuScope(cpuTrace);
+
+    pushCpuScope(cpuTrace, "uniforms");
+    updateCameraBuffer(cameraBuffer, camera);
+    popCpuScope(cpuTrace);
+
+    // per-cube model upload is part of the submission
+    pushCpuScope(cpuTrace, "draw");
+    for (long i = 0; i < cubeCount; i++) {
+      glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(cubeModels[i]));
+      drawIndexBuffer(GL_TRIANGLES, EBO);
+    }
+    popCpuScope(cpuTrace);
+    popGpuScope(gpuProfiler);
+
+    popGpuScope(gpuProfiler);
+    endGpuFrame(gpuProfiler);
+    endGlCounterFrame();
 
     //
-    glfwSwapBuffers(window);
-    glfwPollEvents();
+    presentTracedFrame(window, cpuTrace);
+    if (frame == 0)
+      markFirstFrame(startup);
+    popCpuScope(cpuTrace);
+
+    double currentTime = runTime(window);
+    recordFrame(frameStats, currentTime - previousTime);
+    previousTime = currentTime;
+    frame++;
   }
 
+  bool passed = reportRun(options, "l7", cubeCount, frameStats, gpuProfiler,
+                          startup, processCpuTime() - cpuStart);
+  destroyGpuProfiler(gpuProfiler);
+  if (options.trace != NULL)
+    writeCpuTrace(cpuTrace, options.trace);
+
   glDeleteVertexArrays(1, &VAO);
   glDeleteBuffers(1, &VBO);
-  glDeleteBuffers(1, &EBO);
-  glDeleteProgram(shaderProgram);
+  deleteIndexBuffer(EBO);
+  deleteParameterBlock(cameraBuffer);
+  deleteShaderVariants(cubeShader);
 
-  glfwTerminate();
-  return 0;
+  if (options.headless)
+    destroyHeadlessContext(headless);
+  else
+    glfwTerminate();
+  return passed ? 0 : 1;
 }
\ No newline at end of file
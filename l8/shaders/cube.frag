@@ -0,0 +1,8 @@
+#version 330 core
+out vec4 fragmentColor;
+in vec2 vertexTexture;
+uniform sampler2D uniTexture;
+void main()
+{
+    fragmentColor = texture(uniTexture, vertexTexture);
+}
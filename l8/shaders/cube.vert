@@ -0,0 +1,11 @@
+#version 330 core
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec2 texture;
+#include "camera.glsl"
+uniform mat4 model;
+out vec2 vertexTexture;
+void main()
+{
+    gl_Position = projection * view * model * vec4(position, 1.0);
+    vertexTexture = texture;
+}
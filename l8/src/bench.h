@@ -0,0 +1,147 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <cstdio>
+#include <ctime>
+#include <iostream>
+
+#ifdef __linux__
+#include <sys/resource.h>
+#endif
+
+#include "debug_output.h"
+#include "frame_stats.h"
+#include "gl_counters.h"
+#include "golden.h"
+#include "gpu_profiler.h"
+#include "index_buffer.h"
+#include "options.h"
+#include "overdraw.h"
+#include "parameter_block.h"
+#include "shader.h"
+#include "startup.h"
+#include "vertex_format.h"
+
+// user + system CPU time of the process in seconds
+inline double processCpuTime() {
+#ifdef __linux__
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+         (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+#else
+  return (double)std::clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+// peak resident set size in KiB, 0 where unsupported
+inline long peakMemoryKb() {
+#ifdef __linux__
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+#else
+  return 0;
+#endif
+}
+
+// Appends one JSON object per run (JSON Lines) so benchmark.sh can gather
+// every scene into a single results file. GPU time is the "frame" scope of
+// the GPU profiler; call counts are null unless --gl-counters is on.
+inline bool appendBenchResult(const char *path, const char *scene,
+                              long long scale, const FrameStats &stats,
+                              const GpuProfiler &gpuProfiler,
+                              const StartupProfile &startup,
+                              double cpuSeconds) {
+  FILE *file = std::fopen(path, "a");
+  if (file == NULL) {
+    std::cout << "Failed to write " << path << std::endl;
+    return false;
+  }
+
+  // null rather than a measured-looking 0 when the calls were not counted
+  char drawCalls[32] = "null", stateChanges[32] = "null";
+  if (glCounters().installed) {
+    std::snprintf(drawCalls, sizeof(drawCalls), "%.2f",
+                  glCounterAverage(GL_COUNT_DRAWS));
+    std::snprintf(stateChanges, sizeof(stateChanges), "%.2f",
+                  glCounterAverage(GL_COUNT_PROGRAM_BINDS) +
+                      glCounterAverage(GL_COUNT_VAO_BINDS) +
+                      glCounterAverage(GL_COUNT_TEXTURE_BINDS));
+  }
+
+  FrameSummary summary = summarizeFrames(stats);
+  std::fprintf(file,
+               "{\"scene\": \"%s\", \"scale\": %lld, \"frames\": %zu, "
+               "\"cpu_ms_per_frame\": %.6f, \"frame_mean_ms\": %.6f, "
+               "\"frame_p95_ms\": %.6f, \"frame_p99_ms\": %.6f, "
+               "\"gpu_ms_per_frame\": %.6f, \"peak_rss_kb\": %ld, "
+               "\"draw_calls_per_frame\": %s, "
+               "\"state_changes_per_frame\": %s, "
+               "\"startup_ms\": %.3f}\n",
+               scene, scale, summary.frames,
+               summary.frames ? cpuSeconds / summary.frames * 1000.0 : 0.0,
+               summary.mean * 1000.0, summary.p95 * 1000.0,
+               summary.p99 * 1000.0,
+               gpuScopeAverage(gpuProfiler, "frame") * 1000.0, peakMemoryKb(),
+               drawCalls, stateChanges, startup.firstFrame * 1000.0);
+
+  std::fclose(file);
+  return true;
+}
+
+// budget in milliseconds for the median frame, <= 0 means no budget
+inline bool withinFrameBudget(const FrameSummary &summary, double budget) {
+  if (budget <= 0.0 || summary.p50 * 1000.0 <= budget)
+    return true;
+
+  std::printf("frame budget exceeded: median %.3f ms > %.3f ms\n",
+              summary.p50 * 1000.0, budget);
+  return false;
+}
+
+// End-of-run output shared by the labs: startup phases, frame time summary,
+// the files asked for on the command line, the GPU profile, GL call counts,
+// debug messages and shader cache hits. scale is the scene size that was
+// actually rendered.
+// Returns false when the run missed a budget or its golden image; call it
+// before the offscreen framebuffer is destroyed.
+inline bool reportRun(const RunOptions &options, const char *scene,
+                      long long scale, const FrameStats &stats,
+                      const GpuProfiler &gpuProfiler,
+                      const StartupProfile &startup, double cpuSeconds) {
+  printStartupProfile(startup);
+  FrameSummary summary = summarizeFrames(stats);
+  printFrameSummary(summary);
+  if (options.statsCsv != NULL)
+    writeFrameStatsCsv(stats, options.statsCsv);
+  if (options.statsJson != NULL)
+    writeFrameStatsJson(stats, options.statsJson);
+  printGpuProfile(gpuProfiler);
+  printGlCounters();
+  printDebugOutput();
+  printShaderCache();
+  printParameterStats();
+  printIndexBufferStats();
+  printVertexBufferStats();
+  printOverdraw();
+  if (options.bench != NULL)
+    appendBenchResult(options.bench, scene, scale, stats, gpuProfiler,
+                      startup, cpuSeconds);
+
+  bool passed = withinStartupBudget(startup, options.startupBudget);
+  passed = withinFrameBudget(summary, options.frameBudget) && passed;
+  if (options.capture != NULL || options.golden != NULL) {
+    if (options.headless) {
+      passed = checkGoldenImage(options.capture, options.golden,
+                                options.tolerance) &&
+               passed;
+    } else {
+      std::cout << "--capture and --golden need --headless" << std::endl;
+      passed = false;
+    }
+  }
+  return passed;
+}
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <GLFW/glfw3.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "headless.h"
+
+// Time source for everything that animates. `--clock` selects it:
+//   real            wall clock (default)
+//   fixed[:STEP]    every frame advances by STEP seconds (default 1/60)
+//   script:FILE     frame i uses the i-th time (seconds) listed in FILE and
+//                   keeps the last step once the script runs out
+// With fixed or script two runs see the same time on every frame, so they
+// render identical images regardless of how fast the machine is.
+enum ClockMode { CLOCK_REAL, CLOCK_FIXED, CLOCK_SCRIPTED };
+
+struct Clock {
+  ClockMode mode = CLOCK_REAL;
+  GLFWwindow *window = NULL;
+  double step = 1.0 / 60.0;
+  std::vector<double> script;
+  long frame = -1;
+  double start = 0.0;
+  double time = 0.0;  // seconds since the first tick
+  double delta = 0.0; // seconds since the previous tick
+};
+
+inline bool initClock(Clock &clock, const char *spec, GLFWwindow *window) {
+  clock.window = window;
+  if (spec == NULL || std::strcmp(spec, "real") == 0) {
+    clock.mode = CLOCK_REAL;
+  } else if (std::strncmp(spec, "fixed", 5) == 0) {
+    clock.mode = CLOCK_FIXED;
+    if (spec[5] == ':')
+      clock.step = std::atof(spec + 6);
+    if (clock.step <= 0.0) {
+      std::cout << "Invalid clock step: " << spec << std::endl;
+      return false;
+    }
+  } else if (std::strncmp(spec, "script:", 7) == 0) {
+    clock.mode = CLOCK_SCRIPTED;
+    std::ifstream file(spec + 7);
+    double time;
+    while (file >> time)
+      clock.script.push_back(time);
+    if (clock.script.empty()) {
+      std::cout << "Failed to read clock script " << spec + 7 << std::endl;
+      return false;
+    }
+  } else {
+    std::cout << "Unknown clock: " << spec << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// call once at the start of every frame
+inline void tickClock(Clock &clock) {
+  clock.frame++;
+  double previous = clock.time;
+
+  switch (clock.mode) {
+  case CLOCK_REAL:
+    if (clock.frame == 0)
+      clock.start = runTime(clock.window);
+    clock.time = runTime(clock.window) - clock.start;
+    break;
+  case CLOCK_FIXED:
+    clock.time = clock.frame * clock.step;
+    break;
+  case CLOCK_SCRIPTED: {
+    size_t count = clock.script.size();
+    if ((size_t)clock.frame < count) {
+      clock.time = clock.script[clock.frame];
+    } else {
+      double last = count > 1
+                        ? clock.script[count - 1] - clock.script[count - 2]
+                        : clock.step;
+      clock.time = clock.script[count - 1] + (clock.frame - count + 1) * last;
+    }
+    break;
+  }
+  }
+
+  clock.delta = clock.frame == 0 ? 0.0 : clock.time - previous;
+}
+
+#endif
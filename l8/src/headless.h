@@ -0,0 +1,193 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#ifdef __linux__
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#include <chrono>
+#include <iostream>
+
+#include "options.h"
+#include "overdraw.h"
+
+// Offscreen context for --headless runs: EGL (surfaceless, pbuffer as a
+// fallback) plus an FBO that all rendering goes to. Works on display-less
+// machines with Mesa llvmpipe.
+struct HeadlessContext {
+#ifdef __linux__
+  EGLDisplay display = EGL_NO_DISPLAY;
+  EGLContext context = EGL_NO_CONTEXT;
+  EGLSurface surface = EGL_NO_SURFACE;
+#endif
+  GLuint framebuffer = 0;
+  GLuint colorBuffer = 0;
+  GLuint depthBuffer = 0;
+};
+
+inline void *headlessGetProcAddress(const char *name) {
+#ifdef __linux__
+  return (void *)eglGetProcAddress(name);
+#else
+  return NULL;
+#endif
+}
+
+// debug asks for a debug context (more KHR_debug output, slower)
+inline bool createHeadlessContext(HeadlessContext &headless, GLsizei width,
+                                  GLsizei height, bool debug = false) {
+#ifdef __linux__
+  PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+      (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress(
+          "eglGetPlatformDisplayEXT");
+  if (getPlatformDisplay != NULL)
+    headless.display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+                                          EGL_DEFAULT_DISPLAY, NULL);
+  if (headless.display == EGL_NO_DISPLAY)
+    headless.display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+  if (headless.display == EGL_NO_DISPLAY ||
+      !eglInitialize(headless.display, NULL, NULL)) {
+    std::cout << "Failed to initialize EGL" << std::endl;
+    return false;
+  }
+
+  if (!eglBindAPI(EGL_OPENGL_API)) {
+    std::cout << "Failed to bind OpenGL API" << std::endl;
+    eglTerminate(headless.display);
+    return false;
+  }
+
+  const EGLint configAttributes[] = {EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+                                     EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+                                     EGL_NONE};
+  EGLConfig config;
+  EGLint configCount = 0;
+  if (!eglChooseConfig(headless.display, configAttributes, &config, 1,
+                       &configCount) ||
+      configCount == 0) {
+    std::cout << "Failed to choose EGL config" << std::endl;
+    eglTerminate(headless.display);
+    return false;
+  }
+
+  const EGLint contextAttributes[] = {EGL_CONTEXT_MAJOR_VERSION, 3,
+                                      EGL_CONTEXT_MINOR_VERSION, 3,
+                                      EGL_CONTEXT_OPENGL_PROFILE_MASK,
+                                      EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                                      EGL_CONTEXT_FLAGS_KHR,
+                                      debug ? EGL_CONTEXT_OPENGL_DEBUG_BIT_KHR
+                                            : 0,
+                                      EGL_NONE};
+  headless.context = eglCreateContext(headless.display, config,
+                                      EGL_NO_CONTEXT, contextAttributes);
+  if (headless.context == EGL_NO_CONTEXT) {
+    std::cout << "Failed to create EGL context" << std::endl;
+    eglTerminate(headless.display);
+    return false;
+  }
+
+  // without EGL_KHR_surfaceless_context a pbuffer is needed
+  if (!eglMakeCurrent(headless.display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+                      headless.context)) {
+    const EGLint surfaceAttributes[] = {EGL_WIDTH, width, EGL_HEIGHT, height,
+                                        EGL_NONE};
+    headless.surface =
+        eglCreatePbufferSurface(headless.display, config, surfaceAttributes);
+    if (headless.surface == EGL_NO_SURFACE ||
+        !eglMakeCurrent(headless.display, headless.surface, headless.surface,
+                        headless.context)) {
+      std::cout << "Failed to make EGL context current" << std::endl;
+      eglDestroyContext(headless.display, headless.context);
+      eglTerminate(headless.display);
+      return false;
+    }
+  }
+
+  return true;
+#else
+  (void)debug;
+  std::cout << "Headless mode requires EGL (Linux only)" << std::endl;
+  return false;
+#endif
+}
+
+// call after gladLoadGLLoader; leaves the FBO bound
+inline bool createHeadlessFramebuffer(HeadlessContext &headless, GLsizei width,
+                                      GLsizei height) {
+  glGenRenderbuffers(1, &headless.colorBuffer);
+  glBindRenderbuffer(GL_RENDERBUFFER, headless.colorBuffer);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+  glGenRenderbuffers(1, &headless.depthBuffer);
+  glBindRenderbuffer(GL_RENDERBUFFER, headless.depthBuffer);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+
+  glGenFramebuffers(1, &headless.framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, headless.framebuffer);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                            GL_RENDERBUFFER, headless.colorBuffer);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+                            GL_RENDERBUFFER, headless.depthBuffer);
+
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    std::cout << "Failed to create offscreen framebuffer" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+inline void destroyHeadlessContext(HeadlessContext &headless) {
+  if (headless.framebuffer != 0) {
+    glDeleteFramebuffers(1, &headless.framebuffer);
+    glDeleteRenderbuffers(1, &headless.colorBuffer);
+    glDeleteRenderbuffers(1, &headless.depthBuffer);
+  }
+#ifdef __linux__
+  if (headless.display == EGL_NO_DISPLAY)
+    return;
+  eglMakeCurrent(headless.display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+                 EGL_NO_CONTEXT);
+  if (headless.surface != EGL_NO_SURFACE)
+    eglDestroySurface(headless.display, headless.surface);
+  eglDestroyContext(headless.display, headless.context);
+  eglTerminate(headless.display);
+#endif
+}
+
+// window == NULL means headless
+inline bool keepRunning(GLFWwindow *window, const RunOptions &options,
+                        long frame) {
+  if (options.frames > 0 && frame >= options.frames)
+    return false;
+  return window == NULL || !glfwWindowShouldClose(window);
+}
+
+// ends the frame (and the --overdraw pass over it)
+inline void presentFrame(GLFWwindow *window) {
+  endOverdrawFrame();
+  if (window == NULL) {
+    glFinish();
+    return;
+  }
+  glfwSwapBuffers(window);
+  glfwPollEvents();
+}
+
+// glfwGetTime needs glfwInit, so headless runs keep their own clock
+inline double runTime(GLFWwindow *window) {
+  if (window != NULL)
+    return glfwGetTime();
+
+  static const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+#endif
@@ -10,30 +10,20 @@
 
 #include <iostream>
 #include <string>
-
-const GLchar *vertexShaderSource =
-    "#version 330 core\n"
-    "layout(location = 0) in vec3 position;\n"
-    "layout(location = 1) in vec2 texture;\n"
-    "uniform mat4 model;\n"
-    "uniform mat4 view;\n"
-    "uniform mat4 projection;\n"
-    "out vec2 vertexTexture;\n"
-    "void main()\n"
-    "{\n"
-    "    gl_Position = projection * view * model * vec4(position, 1.0);\n"
-    "    vertexTexture = texture;\n"
-    "}\0";
-
-const GLchar *fragmentShaderSource =
-    "#version 330 core\n"
-    "out vec4 fragmentColor;\n"
-    "in vec2 vertexTexture;\n"
-    "uniform sampler2D uniTexture;\n"
-    "void main()\n"
-    "{\n"
-    "    fragmentColor = texture(uniTexture, vertexTexture);\n"
-    "}\0";
+#include <vector>
+
+#include "bench.h"
+#include "camera_block.h"
+#include "clock.h"
+#include "cpu_trace.h"
+#include "headless.h"
+#include "index_buffer.h"
+#include "mesh_optimize.h"
+#include "mesh_weld.h"
+#include "pipeline.h"
+#include "shader.h"
+#include "shader_files.h"
+#include "vertex_format.h"
 
 
 const unsigned int window_width = 1000;
@@ -83,69 +73,84 @@ void mouseCallback(GLFWwindow* window, double xpos, double ypos) {
   cameraFront = glm::normalize(cameraFront_new);
 }
 
-int main() {
-  // inicjalizacja GLFW
-  glfwInit();
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-  // Tworzenie okna
-  GLFWwindow *window = glfwCreateWindow(window_width, window_height,
-                                        "grafika komputerowa", NULL, NULL);
-  if (window == NULL) {
-    std::cout << "Failed to create GLFW window" << std::endl;
-    glfwTerminate();
-    return -1;
+// --scale N: N cubes in a grid behind the first one; cube 0 stays in place
+glm::vec3 cubeOffset(long index, long count) {
+  long grid = 1;
+  while (grid * grid * grid < count)
+    grid++;
+  float center = (grid - 1) / 2.0f;
+  return glm::vec3(3.0f * (index % grid - center),
+                   3.0f * ((index / grid) % grid - center),
+                   -3.0f * (index / (grid * grid)));
+}
+
+int main(int argc, char **argv) {
+  StartupProfile startup;
+  RunOptions options = parseRunOptions(argc, argv);
+
+  GLFWwindow *window = NULL;
+  HeadlessContext headless;
+
+  if (options.headless) {
+    if (!createHeadlessContext(headless, window_width, window_height,
+                               options.debugOutput))
+      return -1;
+    markStartupPhase(startup, "egl context");
+  } else {
+    // inicjalizacja GLFW
+    glfwInit();
+    markStartupPhase(startup, "glfwInit");
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT,
+                   options.debugOutput ? GLFW_TRUE : GLFW_FALSE);
+
+    // Tworzenie okna
+    window = glfwCreateWindow(window_width, window_height,
+                              "grafika komputerowa", NULL, NULL);
+    if (window == NULL) {
+      std::cout << "Failed to create GLFW window" << std::endl;
+      glfwTerminate();
+      return -1;
+    }
+    glfwMakeContextCurrent(window);
+    markStartupPhase(startup, "window");
   }
-  glfwMakeContextCurrent(window);
 
   // inicjalizacja GLAD
-  if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+  GLADloadproc loader = options.headless ? (GLADloadproc)headlessGetProcAddress
+                                         : (GLADloadproc)glfwGetProcAddress;
+  if (!gladLoadGLLoader(loader)) {
     std::cout << "Failed to initialize GLAD" << std::endl;
     return -1;
   }
 
-  // shadery
-  GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-  glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-  glCompileShader(vertexShader);
-
-  glEnable(GL_DEPTH_TEST);
-
-  GLint status;
-  GLchar error_message[512];
-  glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &status);
-  if (!status) {
-    glGetShaderInfoLog(vertexShader, 512, NULL, error_message);
-    std::cout << "Error (Vertex shader): " << error_message << std::endl;
-  }
-
-  GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-  glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-  glCompileShader(fragmentShader);
-
-  glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &status);
-  if (!status) {
-    glGetShaderInfoLog(fragmentShader, 512, NULL, error_message);
-    std::cout << "Error (Fragment shader): " << error_message << std::endl;
-  }
-
-  GLuint shaderProgram = glCreateProgram();
-  glAttachShader(shaderProgram, vertexShader);
-  glAttachShader(shaderProgram, fragmentShader);
-  glLinkProgram(shaderProgram);
-
-  glGetProgramiv(shaderProgram, GL_LINK_STATUS, &status);
-  if (!status) {
-    glGetProgramInfoLog(shaderProgram, 512, NULL, error_message);
-    std::cout << "Error (Shader program): " << error_message << std::endl;
-  }
+  if (options.glCounters)
+    installGlCounters();
+  if (options.debugOutput)
+    enableDebugOutput(loader);
+  initParallelShaderCompile(loader);
+  if (options.shaderCache != NULL)
+    initShaderCache(options.shaderCache, loader);
+  if (options.spirv != NULL || options.dumpShaders != NULL)
+    initSpirvShaders(options.spirv, options.dumpShaders, loader);
+  if (options.hotReload)
+    initShaderHotReload();
+
+  if (options.headless &&
+      !createHeadlessFramebuffer(headless, window_width, window_height))
+    return -1;
+  if (options.overdraw)
+    enableOverdraw();
+  markStartupPhase(startup, "glad");
 
-  glDetachShader(shaderProgram, vertexShader);
-  glDetachShader(shaderProgram, fragmentShader);
-  glDeleteShader(vertexShader);
-  glDeleteShader(fragmentShader);
+  // shadery
+  ShaderVariants cubeShader = shaderVariants(loadShaderFile("cube.vert"),
+                                             loadShaderFile("cube.frag"));
+  watchShaderVariants(cubeShader, "cube.vert", "cube.frag");
+  submitShaderVariant(cubeShader, 0);
+  markStartupPhase(startup, "shaders");
 
   int width, height, nrChannels;
   stbi_set_flip_vertically_on_load(true);
@@ -163,6 +168,7 @@ int main() {
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  markStartupPhase(startup, "textures");
 
 
   GLfloat vertices[] = {
@@ -210,117 +216,183 @@ int main() {
       -0.5f,  0.5f, -0.5f,    0.0f,  1.0f
   };
 
-  
-  GLuint indices[] = {
-    0, 1, 2, 3, 4, 5, 
-    6, 7, 8, 9, 10, 11, 
-    12, 13, 14, 15, 16, 17, 
-    18, 19, 20, 21, 22, 23, 
-    24, 25, 26, 27, 28, 29, 
-    30, 31, 32, 33, 34, 35
-  };
-
+  // every corner is written out per face; welding shares the ones that
+  // agree in position and UV
+  std::vector<GLfloat> cubeVertices(std::begin(vertices), std::end(vertices));
+  std::vector<GLuint> cubeIndices;
+  weldVertices(cubeVertices, 5, cubeIndices);
+  if (options.optimizeMeshes) {
+    // front to back before the cube starts turning
+    optimizeMesh(cubeVertices, 5, cubeIndices, glm::value_ptr(cameraFront),
+                 "cube");
+  }
 
   GLuint VAO;
   glGenVertexArrays(1, &VAO);
   glBindVertexArray(VAO);
 
-  GLuint VBO;
-  glGenBuffers(1, &VBO);
-  glBindBuffer(GL_ARRAY_BUFFER, VBO);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-  GLuint EBO;
-  glGenBuffers(1, &EBO);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices,
-               GL_STATIC_DRAW);
-
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat),
-                        (void *)0);
-  glEnableVertexAttribArray(0);
-  
-  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat),
-                        (void *)(3 * sizeof(GLfloat)));
-  glEnableVertexAttribArray(1);
+  VertexFormat cubeFormat =
+      vertexFormat({{0, 3, VERTEX_SNORM16}, {1, 2, VERTEX_UNORM16}});
+  GLuint VBO = createVertexBuffer(cubeFormat, cubeVertices.data(),
+                                  cubeVertices.size() / 5, "cube");
 
-  glBindVertexArray(0);
+  IndexBuffer EBO = createIndexBuffer(cubeIndices.data(), cubeIndices.size());
 
-  glViewport(0, 0, (GLuint)window_width, (GLuint)window_height);
+  glBindVertexArray(0);
 
-  GLint viewLoc = glGetUniformLocation(shaderProgram, "view");
+  PipelineState cubeState;
+  cubeState.shader = &cubeShader;
+  cubeState.vertexArray = VAO;
+  cubeState.depthTest = true;
+  cubeState.textures[0] = textures[0];
+  Pipeline cubePipeline = bakePipeline(cubeState);
 
-  GLint modelLoc = glGetUniformLocation(shaderProgram, "model");
-  glUseProgram(shaderProgram);
+  glViewport(0, 0, (GLuint)window_width, (GLuint)window_height);
 
-  glm::mat4 projection = glm::perspective(glm::radians(45.0f), static_cast<float>(window_width)/static_cast<float>(window_height), 0.1f, 100.0f);
+  shaderVariant(cubeShader, 0);
+  // set up for each program, again after --hot-reload replaced it
+  unsigned shaderGeneration = ~0u;
+  GLint modelLoc = -1;
 
-  GLint projectionLoc = glGetUniformLocation(shaderProgram, "projection");
-  glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
+  ParameterBlock cameraBuffer = createCameraBuffer();
+  CameraBlock camera;
+  camera.projection = glm::perspective(glm::radians(45.0f), static_cast<float>(window_width)/static_cast<float>(window_height), 0.1f, 100.0f);
 
 
-  glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-  glfwSetCursorPosCallback(window, mouseCallback);
+  if (window != NULL) {
+    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    glfwSetCursorPosCallback(window, mouseCallback);
+  }
 
-  glfwSwapInterval(0);
-  glfwSetTime(0.0);
+  if (window != NULL) {
+    glfwSwapInterval(0);
+    glfwSetTime(0.0);
+  }
 
   float deltaTime = 0.0f;
   float previousTime = 0.0f;
   float titleUpdateTime = 0.0f;
 
+  FrameStats frameStats;
+  initFrameStats(frameStats);
+
+  GpuProfiler gpuProfiler;
+  gpuProfiler.enabled = options.gpuProfile || options.bench != NULL;
+
+  Clock clock;
+  if (!initClock(clock, options.clock, window))
+    return -1;
+
+  CpuTrace cpuTrace;
+  initCpuTrace(cpuTrace, options.trace != NULL);
+
+  const long cubeCount = options.scale > 0 ? options.scale : 1;
+  std::vector<glm::mat4> cubeModels(cubeCount);
+  markStartupPhase(startup, "scene");
+  double cpuStart = processCpuTime();
+  previousTime = runTime(window);
+
   float totalRotation = 0.0f;
   // pętla zdarzeń
-  while (!glfwWindowShouldClose(window)) {
-    float currentTime = glfwGetTime();
+  long frame = 0;
+  while (keepRunning(window, options, frame)) {
+    pushCpuScope(cpuTrace, "frame");
+    pollShaderFiles();
+
+    // wall time only feeds the statistics, animation runs on the clock
+    float currentTime = runTime(window);
 
     deltaTime = currentTime - previousTime;
     previousTime = currentTime;
+    recordFrame(frameStats, deltaTime);
+
+    tickClock(clock);
+    totalRotation += 45.0f * clock.delta;
+
+    const float cameraSpeed = 2.0f * clock.delta;
+
+    pushCpuScope(cpuTrace, "input");
+    if (window != NULL) {
+      if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+        cameraPosition += cameraSpeed * cameraFront;
+      if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+        cameraPosition -= cameraSpeed * cameraFront;
+      if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+        cameraPosition -= glm::normalize(glm::cross(cameraFront, cameraUp)) * cameraSpeed;
+      if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+        cameraPosition += glm::normalize(glm::cross(cameraFront, cameraUp)) * cameraSpeed;
+    }
+    popCpuScope(cpuTrace);
 
-    totalRotation += 45.0f * deltaTime;
-
-    const float cameraSpeed = 2.0f * deltaTime;
-
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-      cameraPosition += cameraSpeed * cameraFront;
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-      cameraPosition -= cameraSpeed * cameraFront;
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-      cameraPosition -= glm::normalize(glm::cross(cameraFront, cameraUp)) * cameraSpeed;
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-      cameraPosition += glm::normalize(glm::cross(cameraFront, cameraUp)) * cameraSpeed;
-
-    if (currentTime - titleUpdateTime >= 1.0f) {
-      glfwSetWindowTitle(window, ("FPS: " + std::to_string(1.0f / deltaTime) + " Frame time: " + std::to_string(deltaTime*1000.0f) + "ms").c_str());
+    if (window != NULL && currentTime - titleUpdateTime >= 1.0f) {
+      glfwSetWindowTitle(window, ("Frame time: mean " + std::to_string(meanFrameTime(frameStats) * 1000.0) + "ms last " + std::to_string(lastFrameTime(frameStats) * 1000.0) + "ms").c_str());
       titleUpdateTime = currentTime;
     }
     // renderowanie
+    beginGpuFrame(gpuProfiler);
+    pushGpuScope(gpuProfiler, "frame");
+
+    pushGpuScope(gpuProfiler, "clear");
     glClearColor(0.066f, 0.09f, 0.07f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    popGpuScope(gpuProfiler);
+
+    pushGpuScope(gpuProfiler, "cube");
+    const ShaderVariant &shader = applyPipeline(cubePipeline);
+    if (shader.generation != shaderGeneration) {
+      bindCameraBlock(shader.program);
+      modelLoc = uniformLocation(shader.uniforms, "model", GL_FLOAT_MAT4);
+      shaderGeneration = shader.generation;
+    }
 
-    glUseProgram(shaderProgram);
+    pushCpuScope(cpuTrace, "matrices");
+    camera.view = glm::lookAt(cameraPosition, cameraPosition + cameraFront, cameraUp);
+    for (long i = 0; i < cubeCount; i++) {
+      glm::mat4 model = glm::translate(glm::mat4(1.0f), cubeOffset(i, cubeCount));
+      cubeModels[i] = glm::rotate(model, glm::radians(totalRotation), glm::vec3(0.0f, 1.0f, 0.0f));
+    }
+    popCpuScope(cpuTrace);
 
-    glm::mat4 model = glm::mat4(1.0f);
-    model = glm::rotate(model, glm::radians(totalRotation), glm::vec3(0.0f, 1.0f, 0.0f));
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+    pushCpuScope(cpuTrace, "uniforms");
+    updateCameraBuffer(cameraBuffer, camera);
+    popCpuScope(cpuTrace);
 
-    glm::mat4 view = glm::lookAt(cameraPosition, cameraPosition + cameraFront, cameraUp);
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
+    // per-cube model upload is part of the submission
+    pushCpuScope(cpuTrace, "draw");
+    for (long i = 0; i < cubeCount; i++) {
+      glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(cubeModels[i]));
+      drawIndexBuffer(GL_TRIANGLES, EBO);
+    }
+    popCpuScope(cpuTrace);
+    popGpuScope(gpuProfiler);
 
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+    popGpuScope(gpuProfiler);
+    endGpuFrame(gpuProfiler);
+    endGlCounterFrame();
 
     //
-    glfwSwapBuffers(window);
-    glfwPollEvents();
+    presentTracedFrame(window, cpuTrace);
+    if (frame == 0)
+      markFirstFrame(startup);
+    popCpuScope(cpuTrace);
+    frame++;
   }
 
+  bool passed = reportRun(options, "l8", cubeCount, frameStats, gpuProfiler,
+                          startup, processCpuTime() - cpuStart);
+  destroyGpuProfiler(gpuProfiler);
+  if (options.trace != NULL)
+    writeCpuTrace(cpuTrace, options.trace);
+
   glDeleteVertexArrays(1, &VAO);
   glDeleteBuffers(1, &VBO);
-  glDeleteBuffers(1, &EBO);
-  glDeleteProgram(shaderProgram);
+  deleteIndexBuffer(EBO);
+  deleteParameterBlock(cameraBuffer);
+  deleteShaderVariants(cubeShader);
 
-  glfwTerminate();
-  return 0;
+  if (options.headless)
+    destroyHeadlessContext(headless);
+  else
+    glfwTerminate();
+  return passed ? 0 : 1;
 }
\ No newline at end of file
@@ -0,0 +1,270 @@
+#ifndef MESH_OPTIMIZE_H
+#define MESH_OPTIMIZE_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+// Reordering of indexed triangle lists (--optimize-meshes), in three passes
+// that run on plain arrays, at load time here or ahead of time in a tool:
+//
+//   optimizeVertexCache  triangles in an order that reuses the vertices the
+//                        post-transform cache still holds (Forsyth's
+//                        linear-speed algorithm, LRU cache of 32)
+//   optimizeOverdraw     runs of that order, split where the cache starts
+//                        over, sorted front to back along a view direction
+//                        so the depth test rejects more of what is hidden
+//   optimizeVertexFetch  vertices renumbered in the order they are first
+//                        used, so fetching them walks memory forward
+//
+// The result is measured with a FIFO cache of meshCacheSize entries: ACMR
+// is vertices transformed per triangle (0.5 is the best a regular grid
+// reaches, 3 means no reuse), ATVR vertices transformed per vertex (1 means
+// each is transformed once).
+const size_t meshCacheSize = 16;    // FIFO used for the statistics
+const size_t forsythCacheSize = 32; // LRU the vertex scores model
+const unsigned forsythCandidates = 32; // triangles scored per cached vertex
+
+struct VertexCacheStats {
+  double acmr = 0.0;
+  double atvr = 0.0;
+};
+
+inline VertexCacheStats analyzeVertexCache(const std::vector<GLuint> &indices,
+                                           size_t vertexCount,
+                                           size_t cacheSize = meshCacheSize) {
+  std::vector<size_t> insertedAt(vertexCount, 0); // 0 = never cached
+  size_t misses = 0;
+  for (GLuint index : indices) {
+    // in the FIFO when it went in fewer than cacheSize misses ago
+    if (insertedAt[index] == 0 || misses - insertedAt[index] >= cacheSize) {
+      misses++;
+      insertedAt[index] = misses;
+    }
+  }
+
+  VertexCacheStats stats;
+  if (indices.size() >= 3)
+    stats.acmr = (double)misses / (double)(indices.size() / 3);
+  if (vertexCount > 0)
+    stats.atvr = (double)misses / (double)vertexCount;
+  return stats;
+}
+
+inline float forsythVertexScore(int cachePosition, unsigned remaining) {
+  if (remaining == 0)
+    return -1.0f;
+  float score = 0.0f;
+  if (cachePosition >= 0) {
+    // the last triangle's vertices score the same, so no single one of them
+    // is favored
+    if (cachePosition < 3)
+      score = 0.75f;
+    else
+      score = std::pow(1.0f - (float)(cachePosition - 3) /
+                                  (float)(forsythCacheSize - 3),
+                       1.5f);
+  }
+  // vertices with few triangles left are finished off first
+  return score + 2.0f / std::sqrt((float)remaining);
+}
+
+inline void optimizeVertexCache(std::vector<GLuint> &indices,
+                                size_t vertexCount) {
+  size_t triangleCount = indices.size() / 3;
+  if (triangleCount == 0)
+    return;
+
+  // triangles of each vertex; the first remaining[v] entries are not drawn
+  // yet. slot[corner] is where the corner's triangle sits in its vertex's
+  // list, so drawing a triangle is constant time even for a fan's center.
+  std::vector<unsigned> remaining(vertexCount, 0);
+  for (GLuint index : indices)
+    remaining[index]++;
+  std::vector<size_t> offsets(vertexCount + 1, 0);
+  for (size_t v = 0; v < vertexCount; v++)
+    offsets[v + 1] = offsets[v] + remaining[v];
+  std::vector<size_t> triangles(indices.size());
+  std::vector<unsigned> slot(indices.size());
+  std::vector<unsigned> filled(vertexCount, 0);
+  for (size_t corner = 0; corner < indices.size(); corner++) {
+    GLuint v = indices[corner];
+    slot[corner] = filled[v]++;
+    triangles[offsets[v] + slot[corner]] = corner / 3;
+  }
+
+  std::vector<float> vertexScore(vertexCount);
+  for (size_t v = 0; v < vertexCount; v++)
+    vertexScore[v] = forsythVertexScore(-1, remaining[v]);
+  std::vector<bool> drawn(triangleCount, false);
+
+  std::vector<GLuint> cache, nextCache;
+  std::vector<GLuint> output;
+  output.reserve(indices.size());
+  size_t best = 0;     // next triangle to draw
+  size_t scanFrom = 0; // every triangle before it is drawn
+  for (size_t emitted = 0; emitted < triangleCount; emitted++) {
+    drawn[best] = true;
+    const GLuint *triangle = &indices[3 * best];
+    output.insert(output.end(), triangle, triangle + 3);
+
+    // take the triangle off its vertices' lists of triangles to draw: swap
+    // it with the last one still to draw
+    for (size_t corner = 3 * best; corner < 3 * best + 3; corner++) {
+      GLuint v = indices[corner];
+      size_t *list = &triangles[offsets[v]];
+      unsigned last = --remaining[v];
+      size_t moved = list[last];
+      for (size_t other = 3 * moved; other < 3 * moved + 3; other++) {
+        if (indices[other] == v && slot[other] == last) {
+          slot[other] = slot[corner];
+          break;
+        }
+      }
+      list[slot[corner]] = moved;
+      list[last] = best;
+      slot[corner] = last;
+    }
+
+    // LRU: the triangle's vertices move to the front
+    nextCache.assign(triangle, triangle + 3);
+    for (GLuint v : cache)
+      if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+        nextCache.push_back(v);
+    for (size_t i = forsythCacheSize; i < nextCache.size(); i++)
+      vertexScore[nextCache[i]] =
+          forsythVertexScore(-1, remaining[nextCache[i]]);
+    if (nextCache.size() > forsythCacheSize)
+      nextCache.resize(forsythCacheSize);
+    cache.swap(nextCache);
+
+    // rescore what is cached and pick the best triangle touching it
+    for (size_t i = 0; i < cache.size(); i++)
+      vertexScore[cache[i]] = forsythVertexScore((int)i, remaining[cache[i]]);
+    float bestScore = -1.0f;
+    for (GLuint v : cache) {
+      unsigned candidates = std::min(remaining[v], forsythCandidates);
+      for (unsigned i = 0; i < candidates; i++) {
+        size_t t = triangles[offsets[v] + i];
+        float score = vertexScore[indices[3 * t]] +
+                      vertexScore[indices[3 * t + 1]] +
+                      vertexScore[indices[3 * t + 2]];
+        if (score > bestScore) {
+          bestScore = score;
+          best = t;
+        }
+      }
+    }
+    if (bestScore < 0.0f) {
+      // nothing cached has triangles left: continue in input order
+      while (scanFrom < triangleCount && drawn[scanFrom])
+        scanFrom++;
+      best = scanFrom;
+    }
+  }
+  indices.swap(output);
+}
+
+// Returns the number of clusters. viewDirection is where the camera looks,
+// in the mesh's coordinates; positions are the first three (or stride, when
+// fewer) floats of every stride floats.
+inline size_t optimizeOverdraw(std::vector<GLuint> &indices,
+                               const std::vector<GLfloat> &vertices,
+                               size_t stride, const GLfloat viewDirection[3]) {
+  size_t triangleCount = indices.size() / 3;
+  size_t vertexCount = vertices.size() / stride;
+  size_t components = std::min<size_t>(stride, 3);
+
+  // a cluster starts where all three vertices miss the FIFO, so moving it
+  // loses nothing the cache would have kept
+  std::vector<size_t> clusterStart;
+  std::vector<size_t> insertedAt(vertexCount, 0);
+  size_t misses = 0;
+  for (size_t t = 0; t < triangleCount; t++) {
+    int triangleMisses = 0;
+    for (int k = 0; k < 3; k++) {
+      GLuint index = indices[3 * t + k];
+      if (insertedAt[index] == 0 ||
+          misses - insertedAt[index] >= meshCacheSize) {
+        misses++;
+        insertedAt[index] = misses;
+        triangleMisses++;
+      }
+    }
+    if (t == 0 || triangleMisses == 3)
+      clusterStart.push_back(t);
+  }
+  clusterStart.push_back(triangleCount);
+
+  struct Cluster {
+    size_t first, count;
+    float depth; // centroid along the view direction, nearest first
+  };
+  std::vector<Cluster> clusters;
+  for (size_t c = 0; c + 1 < clusterStart.size(); c++) {
+    Cluster cluster = {clusterStart[c], clusterStart[c + 1] - clusterStart[c],
+                       0.0f};
+    for (size_t i = 3 * cluster.first; i < 3 * (cluster.first + cluster.count);
+         i++) {
+      const GLfloat *position = &vertices[indices[i] * stride];
+      for (size_t k = 0; k < components; k++)
+        cluster.depth += position[k] * viewDirection[k];
+    }
+    cluster.depth /= (float)(3 * cluster.count);
+    clusters.push_back(cluster);
+  }
+  std::stable_sort(clusters.begin(), clusters.end(),
+                   [](const Cluster &a, const Cluster &b) {
+                     return a.depth < b.depth;
+                   });
+
+  std::vector<GLuint> output;
+  output.reserve(indices.size());
+  for (const Cluster &cluster : clusters)
+    output.insert(output.end(), indices.begin() + 3 * cluster.first,
+                  indices.begin() + 3 * (cluster.first + cluster.count));
+  indices.swap(output);
+  return clusters.size();
+}
+
+// Renumbers vertices in order of first use and drops unused ones; vertices
+// holds stride floats per vertex.
+inline void optimizeVertexFetch(std::vector<GLfloat> &vertices, size_t stride,
+                                std::vector<GLuint> &indices) {
+  size_t vertexCount = vertices.size() / stride;
+  std::vector<GLuint> remap(vertexCount, ~0u);
+  std::vector<GLfloat> output;
+  output.reserve(vertices.size());
+  GLuint next = 0;
+  for (GLuint &index : indices) {
+    if (remap[index] == ~0u) {
+      remap[index] = next++;
+      output.insert(output.end(), vertices.begin() + index * stride,
+                    vertices.begin() + (index + 1) * stride);
+    }
+    index = remap[index];
+  }
+  vertices.swap(output);
+}
+
+// all three passes, with the statistics before and after printed under name
+inline void optimizeMesh(std::vector<GLfloat> &vertices, size_t stride,
+                         std::vector<GLuint> &indices,
+                         const GLfloat viewDirection[3], const char *name) {
+  size_t vertexCount = vertices.size() / stride;
+  VertexCacheStats before = analyzeVertexCache(indices, vertexCount);
+  optimizeVertexCache(indices, vertexCount);
+  size_t clusters = optimizeOverdraw(indices, vertices, stride, viewDirection);
+  optimizeVertexFetch(vertices, stride, indices);
+  VertexCacheStats after =
+      analyzeVertexCache(indices, vertices.size() / stride);
+  std::printf("%s: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f (FIFO %zu), "
+              "%zu overdraw clusters\n",
+              name, before.acmr, after.acmr, before.atvr, after.atvr,
+              meshCacheSize, clusters);
+}
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef MESH_WELD_H
+#define MESH_WELD_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "vertex_format.h"
+
+// Welding: vertices whose attributes are all equal become one, and the
+// indices point at the survivor. A vertex is hashed over all of its stride
+// floats into an open-addressing table sized to twice the vertex count, so
+// a mesh of any size is welded in one pass of expected constant work per
+// vertex. Equality is float ==, so 0.0 and -0.0 weld and NaNs never do.
+
+inline uint32_t hashVertex(const GLfloat *vertex, size_t stride) {
+  uint32_t hash = 2166136261u; // FNV-1a over the float bits
+  for (size_t i = 0; i < stride; i++) {
+    uint32_t bits = 0;
+    if (vertex[i] != 0.0f) // -0.0 hashes like 0.0
+      std::memcpy(&bits, &vertex[i], sizeof(bits));
+    for (int byte = 0; byte < 4; byte++) {
+      hash ^= (bits >> (8 * byte)) & 0xFF;
+      hash *= 16777619u;
+    }
+  }
+  return hash;
+}
+
+inline bool sameVertex(const GLfloat *a, const GLfloat *b, size_t stride) {
+  for (size_t i = 0; i < stride; i++)
+    if (!(a[i] == b[i]))
+      return false;
+  return true;
+}
+
+// Keeps the first of every set of equal vertices, in their original order,
+// and rewrites indices to match; empty indices stand for 0, 1, 2, ... (an
+// unindexed mesh) and come back filled in. Returns the vertex count before;
+// both counts are added to the vertex buffer statistics.
+inline size_t weldVertices(std::vector<GLfloat> &vertices, size_t stride,
+                           std::vector<GLuint> &indices) {
+  size_t vertexCount = vertices.size() / stride;
+  if (indices.empty()) {
+    indices.resize(vertexCount);
+    for (size_t i = 0; i < vertexCount; i++)
+      indices[i] = (GLuint)i;
+  }
+
+  size_t tableSize = 1;
+  while (tableSize < 2 * vertexCount)
+    tableSize *= 2;
+  std::vector<GLuint> table(tableSize, ~0u); // index into welded
+  std::vector<GLuint> remap(vertexCount);
+  std::vector<GLfloat> welded;
+  welded.reserve(vertices.size());
+  for (size_t v = 0; v < vertexCount; v++) {
+    const GLfloat *vertex = &vertices[v * stride];
+    size_t slot = hashVertex(vertex, stride) & (tableSize - 1);
+    while (table[slot] != ~0u &&
+           !sameVertex(&welded[table[slot] * stride], vertex, stride))
+      slot = (slot + 1) & (tableSize - 1);
+    if (table[slot] == ~0u) {
+      table[slot] = (GLuint)(welded.size() / stride);
+      welded.insert(welded.end(), vertex, vertex + stride);
+    }
+    remap[v] = table[slot];
+  }
+
+  for (GLuint &index : indices)
+    index = remap[index];
+  vertices.swap(welded);
+  VertexBufferStats &stats = vertexBufferStats();
+  stats.weldedFrom += (long)vertexCount;
+  stats.weldedTo += (long)(vertices.size() / stride);
+  return vertexCount;
+}
+
+#endif
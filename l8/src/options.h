@@ -0,0 +1,126 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <cstdlib>
+#include <cstring>
+
+// command line options
+//   --headless     render offscreen (EGL, no window)
+//   --frames N     stop after N frames (default 300 when headless)
+//   --stats-csv F  write per-frame times to F on exit
+//   --stats-json F write the frame time summary and samples to F on exit
+//   --gpu-profile  measure GPU time per scope and print it on exit
+//   --clock C      animation time source: real, fixed[:STEP], script:FILE
+//   --scale S      scene size: polygon n (l3), copies of the shapes (l6),
+//                  cube count (l7, l8); other labs have a fixed scene
+//   --bench F      append a benchmark result (JSON line) to F on exit
+//   --gl-counters  count GL calls and redundant binds per frame
+//   --trace F      write CPU scopes of the render loop to F as a Chrome trace
+//                  (l6, l7, l8)
+//   --startup-budget MS  fail the run (exit code 1) when the first frame takes
+//                  longer than MS milliseconds from the start of main
+//   --debug-output collect GL_KHR_debug messages (debug context) and print
+//                  them grouped and ranked on exit
+//   --capture F    write the last frame to F (downsampled PPM, headless only)
+//   --golden F     compare the last frame to the reference image F and fail
+//                  the run when it differs (headless only)
+//   --tolerance T  per-pixel difference allowed by --golden, 0..1 (0.1)
+//   --frame-budget MS  fail the run when the median frame takes longer
+//   --shader-cache DIR keep linked program binaries in DIR and reuse them
+//                  on the next start
+//   --spirv DIR    load shader stages precompiled by spirv.sh from DIR
+//                  (ARB_gl_spirv), GLSL for anything missing
+//   --dump-shaders DIR write every GLSL stage to DIR for spirv.sh
+//   --hot-reload   watch the lab's shaders/ directory and rebuild programs
+//                  whose files change while the lab is running
+//   --strip        l3: draw the polygon as one triangle strip (n indices
+//                  instead of 3n)
+//   --optimize-meshes  reorder mesh indices for the vertex cache and overdraw
+//                  and vertices for fetch, printing ACMR/ATVR (l3, l7, l8)
+//   --overdraw     show fragments shaded per pixel as a heat map and print
+//                  the overdraw ratio on exit
+struct RunOptions {
+  bool headless = false;
+  long frames = 0;
+  const char *statsCsv = NULL;
+  const char *statsJson = NULL;
+  bool gpuProfile = false;
+  const char *clock = "real";
+  long long scale = 0; // 0 = the lab's default scene; 64-bit on Windows too
+  const char *bench = NULL;
+  bool glCounters = false;
+  const char *trace = NULL;
+  double startupBudget = 0.0; // ms, 0 = no budget
+  bool debugOutput = false;
+  const char *capture = NULL;
+  const char *golden = NULL;
+  double tolerance = 0.1;
+  double frameBudget = 0.0; // ms, 0 = no budget
+  const char *shaderCache = NULL;
+  const char *spirv = NULL;
+  const char *dumpShaders = NULL;
+  bool hotReload = false;
+  bool strip = false;
+  bool optimizeMeshes = false;
+  bool overdraw = false;
+};
+
+inline RunOptions parseRunOptions(int argc, char **argv) {
+  RunOptions options;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--headless") == 0) {
+      options.headless = true;
+    } else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+      options.frames = std::atol(argv[++i]);
+    } else if (std::strcmp(argv[i], "--stats-csv") == 0 && i + 1 < argc) {
+      options.statsCsv = argv[++i];
+    } else if (std::strcmp(argv[i], "--stats-json") == 0 && i + 1 < argc) {
+      options.statsJson = argv[++i];
+    } else if (std::strcmp(argv[i], "--gpu-profile") == 0) {
+      options.gpuProfile = true;
+    } else if (std::strcmp(argv[i], "--clock") == 0 && i + 1 < argc) {
+      options.clock = argv[++i];
+    } else if (std::strcmp(argv[i], "--scale") == 0 && i + 1 < argc) {
+      options.scale = std::strtoll(argv[++i], NULL, 10);
+    } else if (std::strcmp(argv[i], "--bench") == 0 && i + 1 < argc) {
+      options.bench = argv[++i];
+    } else if (std::strcmp(argv[i], "--gl-counters") == 0) {
+      options.glCounters = true;
+    } else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+      options.trace = argv[++i];
+    } else if (std::strcmp(argv[i], "--startup-budget") == 0 && i + 1 < argc) {
+      options.startupBudget = std::atof(argv[++i]);
+    } else if (std::strcmp(argv[i], "--debug-output") == 0) {
+      options.debugOutput = true;
+    } else if (std::strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+      options.capture = argv[++i];
+    } else if (std::strcmp(argv[i], "--golden") == 0 && i + 1 < argc) {
+      options.golden = argv[++i];
+    } else if (std::strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) {
+      options.tolerance = std::atof(argv[++i]);
+    } else if (std::strcmp(argv[i], "--frame-budget") == 0 && i + 1 < argc) {
+      options.frameBudget = std::atof(argv[++i]);
+    } else if (std::strcmp(argv[i], "--shader-cache") == 0 && i + 1 < argc) {
+      options.shaderCache = argv[++i];
+    } else if (std::strcmp(argv[i], "--spirv") == 0 && i + 1 < argc) {
+      options.spirv = argv[++i];
+    } else if (std::strcmp(argv[i], "--dump-shaders") == 0 && i + 1 < argc) {
+      options.dumpShaders = argv[++i];
+    } else if (std::strcmp(argv[i], "--hot-reload") == 0) {
+      options.hotReload = true;
+    } else if (std::strcmp(argv[i], "--strip") == 0) {
+      options.strip = true;
+    } else if (std::strcmp(argv[i], "--optimize-meshes") == 0) {
+      options.optimizeMeshes = true;
+    } else if (std::strcmp(argv[i], "--overdraw") == 0) {
+      options.overdraw = true;
+    }
+  }
+
+  if (options.headless && options.frames <= 0)
+    options.frames = 300;
+
+  return options;
+}
+
+#endif
@@ -0,0 +1,219 @@
+#ifndef PARAMETER_BLOCK_H
+#define PARAMETER_BLOCK_H
+
+#include <glad/glad.h>
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// Shader parameters shadowed on the CPU, so a value that did not change is
+// not sent again. A ParameterBlock is a uniform buffer with one std140 slot
+// per material; each setParameter compares against the copy of what the
+// buffer holds and only dirty bytes are uploaded. UniformShadow does the same
+// for plain uniforms of one program. Skipped uploads are counted and printed
+// on exit.
+struct ParameterStats {
+  long uploads = 0;
+  long skipped = 0;
+};
+
+inline ParameterStats &parameterStats() {
+  static ParameterStats stats;
+  return stats;
+}
+
+struct ParameterBlock {
+  GLuint buffer = 0;
+  GLsizeiptr size = 0;   // bytes used by one slot
+  GLsizeiptr stride = 0; // size rounded up to the uniform buffer alignment
+  std::vector<unsigned char> shadow; // what the buffer holds
+};
+
+// What each uniform buffer binding point holds, so binding the same range
+// again is skipped. It belongs to the binding point, not the block: any
+// block, or a direct glBindBufferRange, can replace it. Code that binds
+// uniform buffers without bindParameterBlock calls resetParameterBindings.
+const GLuint parameterBindings = 36; // GL_MAX_UNIFORM_BUFFER_BINDINGS in 3.3
+
+struct ParameterBinding {
+  GLuint buffer = 0;
+  GLintptr offset = 0;
+  GLsizeiptr size = 0;
+};
+
+inline ParameterBinding *parameterBindingTable() {
+  static ParameterBinding bindings[parameterBindings];
+  return bindings;
+}
+
+inline void resetParameterBindings() {
+  ParameterBinding *bindings = parameterBindingTable();
+  for (GLuint i = 0; i < parameterBindings; i++)
+    bindings[i] = ParameterBinding();
+}
+
+// all slots start zeroed, on the GPU and in the shadow
+inline ParameterBlock createParameterBlock(GLsizeiptr size, int slots = 1) {
+  GLint alignment = 1;
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+  if (alignment < 1)
+    alignment = 1;
+
+  ParameterBlock block;
+  block.size = size;
+  block.stride = (size + alignment - 1) / alignment * alignment;
+  block.shadow.assign((size_t)(block.stride * slots), 0);
+  glGenBuffers(1, &block.buffer);
+  glBindBuffer(GL_UNIFORM_BUFFER, block.buffer);
+  glBufferData(GL_UNIFORM_BUFFER, (GLsizeiptr)block.shadow.size(),
+               block.shadow.data(), GL_DYNAMIC_DRAW);
+  return block;
+}
+
+// writes size bytes at offset into the slot if they differ from the shadow
+inline void setParameters(ParameterBlock &block, int slot, GLintptr offset,
+                          const void *data, GLsizeiptr size) {
+  unsigned char *shadow = &block.shadow[(size_t)(slot * block.stride + offset)];
+  if (std::memcmp(shadow, data, (size_t)size) == 0) {
+    parameterStats().skipped++;
+    return;
+  }
+
+  std::memcpy(shadow, data, (size_t)size);
+  glBindBuffer(GL_UNIFORM_BUFFER, block.buffer);
+  glBufferSubData(GL_UNIFORM_BUFFER, slot * block.stride + offset, size, data);
+  parameterStats().uploads++;
+}
+
+// one field, e.g. setParameter(block, 0, offsetof(Material, color), color)
+template <typename T>
+inline void setParameter(ParameterBlock &block, int slot, GLintptr offset,
+                         const T &value) {
+  setParameters(block, slot, offset, &value, sizeof(T));
+}
+
+// attaches the slot to a binding point unless it is already bound there
+inline void bindParameterBlock(const ParameterBlock &block, int slot,
+                               GLuint binding) {
+  ParameterBinding range;
+  range.buffer = block.buffer;
+  range.offset = slot * block.stride;
+  range.size = block.size;
+  if (binding < parameterBindings) {
+    ParameterBinding &bound = parameterBindingTable()[binding];
+    if (bound.buffer == range.buffer && bound.offset == range.offset &&
+        bound.size == range.size)
+      return;
+    bound = range;
+  }
+  glBindBufferRange(GL_UNIFORM_BUFFER, binding, range.buffer, range.offset,
+                    range.size);
+}
+
+inline void deleteParameterBlock(ParameterBlock &block) {
+  // the name may be handed out again for another buffer
+  ParameterBinding *bindings = parameterBindingTable();
+  for (GLuint i = 0; i < parameterBindings; i++)
+    if (bindings[i].buffer == block.buffer)
+      bindings[i] = ParameterBinding();
+  glDeleteBuffers(1, &block.buffer);
+  block.buffer = 0;
+}
+
+// Points the program's uniform block at binding, once per linked program.
+// Reports programs without the block or with a size that does not match
+// the C++ struct.
+inline bool bindUniformBlock(GLuint program, const char *blockName,
+                             GLuint binding, GLsizeiptr expectedSize,
+                             const char *name = "Shader program") {
+  GLuint index = glGetUniformBlockIndex(program, blockName);
+  if (index == GL_INVALID_INDEX) {
+    std::cout << "Error (" << name << "): no active " << blockName
+              << " block" << std::endl;
+    return false;
+  }
+
+  GLint size = 0;
+  glGetActiveUniformBlockiv(program, index, GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+  if (size != (GLint)expectedSize) {
+    std::cout << "Error (" << name << "): " << blockName << " block is "
+              << size << " bytes, expected " << expectedSize << std::endl;
+    return false;
+  }
+
+  glUniformBlockBinding(program, index, binding);
+  return true;
+}
+
+// last values sent to the plain uniforms of one program; reset it when the
+// program is relinked, which sets every uniform back to zero
+struct ShadowedUniform {
+  GLint location;
+  std::vector<GLfloat> value;
+};
+
+struct UniformShadow {
+  std::vector<ShadowedUniform> uniforms;
+};
+
+inline void resetUniformShadow(UniformShadow &shadow) {
+  shadow.uniforms.clear();
+}
+
+// true when the value differs from the last one sent to location
+inline bool uniformDirty(UniformShadow &shadow, GLint location,
+                         const GLfloat *value, size_t count) {
+  if (location < 0)
+    return false;
+  for (ShadowedUniform &uniform : shadow.uniforms) {
+    if (uniform.location != location)
+      continue;
+    if (uniform.value.size() == count &&
+        std::memcmp(uniform.value.data(), value, count * sizeof(GLfloat)) ==
+            0) {
+      parameterStats().skipped++;
+      return false;
+    }
+    uniform.value.assign(value, value + count);
+    parameterStats().uploads++;
+    return true;
+  }
+
+  ShadowedUniform uniform;
+  uniform.location = location;
+  uniform.value.assign(value, value + count);
+  shadow.uniforms.push_back(uniform);
+  parameterStats().uploads++;
+  return true;
+}
+
+inline void shadowUniform1f(UniformShadow &shadow, GLint location,
+                            GLfloat value) {
+  if (uniformDirty(shadow, location, &value, 1))
+    glUniform1f(location, value);
+}
+
+inline void shadowUniform3fv(UniformShadow &shadow, GLint location,
+                             const GLfloat *value) {
+  if (uniformDirty(shadow, location, value, 3))
+    glUniform3fv(location, 1, value);
+}
+
+inline void shadowUniformMatrix4fv(UniformShadow &shadow, GLint location,
+                                   const GLfloat *value) {
+  if (uniformDirty(shadow, location, value, 16))
+    glUniformMatrix4fv(location, 1, GL_FALSE, value);
+}
+
+inline void printParameterStats() {
+  const ParameterStats &stats = parameterStats();
+  long total = stats.uploads + stats.skipped;
+  if (total == 0)
+    return;
+  std::printf("parameter uploads: %ld sent, %ld skipped (%.1f%% unchanged)\n",
+              stats.uploads, stats.skipped, 100.0 * stats.skipped / total);
+}
+
+#endif
@@ -0,0 +1,61 @@
+#!/bin/sh
+# Offline SPIR-V for the GLSL strings in the labs: every lab runs one headless
+# frame with --dump-shaders, so the exact stage text (permutation defines
+# included) lands in _spirv/glsl, and glslangValidator compiles each stage
+# for OpenGL into _spirv/<hash>.<stage>.spv. Run a lab with
+#
+#   --spirv ../../_spirv
+#
+# (from lN/src) to load them. Stages glslang rejects are skipped; the lab
+# compiles those from GLSL at run time, as it does for edited shaders.
+# Uses the same build as benchmark.sh (CXX, CXXFLAGS and LIBS).
+set -e
+cd "$(dirname "$0")"
+
+OUT=_spirv
+CXX=${CXX:-g++}
+CXXFLAGS=${CXXFLAGS:--O2 -std=c++17}
+LIBS=${LIBS:--lglfw -lEGL -ldl -pthread}
+GLSLANG=${GLSLANG:-glslangValidator}
+
+if ! command -v "$GLSLANG" > /dev/null; then
+  echo "$GLSLANG not found (set GLSLANG)"
+  exit 1
+fi
+
+mkdir -p "$OUT/bin" "$OUT/glsl"
+
+# dump <lab> <source> [options...]
+dump() {
+  lab=$1
+  source=$2
+  shift 2
+  $CXX $CXXFLAGS -I"$lab/include" -Il5/include "$lab/src/$source.cpp" \
+    "$lab/src/glad.c" $LIBS -o "$OUT/bin/$lab-$source"
+  (cd "$lab/src" && "../../$OUT/bin/$lab-$source" --headless --frames 1 \
+    --dump-shaders "../../$OUT/glsl" "$@") > /dev/null
+}
+
+dump l2 main
+dump l2 main2
+dump l3 main --scale 1000
+dump l4 main
+dump l5 main
+dump l6 main
+dump l7 main
+dump l8 main
+
+COMPILED=0
+SKIPPED=0
+for stage in "$OUT"/glsl/*.vert "$OUT"/glsl/*.frag; do
+  [ -f "$stage" ] || continue
+  # GL SPIR-V needs explicit locations and bindings; glslang assigns them
+  if "$GLSLANG" -G --auto-map-locations --auto-map-bindings -o \
+      "$OUT/$(basename "$stage").spv" "$stage" > "$stage.log"; then
+    COMPILED=$((COMPILED + 1))
+  else
+    echo "skipped $stage (see $stage.log)"
+    SKIPPED=$((SKIPPED + 1))
+  fi
+done
+echo "$COMPILED stages compiled, $SKIPPED skipped"